@@ -1,20 +1,343 @@
 #include "GFW.h"
 
 GFW::Text::FontManager GFW::Inst::fontManager = GFW::Text::FontManager();
+GFW::Circle::SpriteCache GFW::Circle::Circle::spriteCache = GFW::Circle::SpriteCache();
+GFW::Image::TextureCache GFW::Image::Image::textureCache;
 
 SDL_Color GFW::GFW_GetRenderDrawColor(SDL_Renderer* renderer) {
+	Render::StateTracker* tracker = Render::StateTracker::Find(renderer);
+	if (tracker != nullptr) {
+		return tracker->GetDrawColor();
+	}
+
 	Uint8 r, g, b, a;
 	SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
 	return { r, g, b, a };
 }
 
 void GFW::GFW_SetRenderDrawColor(SDL_Renderer* renderer, SDL_Color color) {
+	Render::StateTracker* tracker = Render::StateTracker::Find(renderer);
+	if (tracker != nullptr) {
+		tracker->SetDrawColor(color);
+		return;
+	}
+
 	SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
 }
 
-GFW::Inst::Inst()
+//the table only holds a quarter turn, the other quadrants are mirrored from it
+static const int QuarterSteps = GFW_FIXED_TRIG_STEPS / 4;
+
+static vector<Sint32> BuildFixedSinTable()
+{
+	//taylor series evaluated in 2.30 integer arithmetic so the table is the same on every machine
+	const Sint64 halfPi = 1686629713; //pi / 2 in 2.30
+	vector<Sint32> table(QuarterSteps + 1);
+
+	for (int i = 0; i <= QuarterSteps; i++) {
+		Sint64 x = halfPi * i / QuarterSteps;
+		Sint64 x2 = (x * x) >> 30;
+		Sint64 term = x;
+		Sint64 sum = x;
+
+		for (int n = 1; n <= 7; n++) {
+			term = -((term * x2) >> 30) / ((2 * n) * (2 * n + 1));
+			sum += term;
+		}
+
+		table[i] = static_cast<Sint32>((sum + (1 << (29 - GFW_FIXED_FRACTION_BITS))) >> (30 - GFW_FIXED_FRACTION_BITS));
+	}
+
+	return table;
+}
+
+static const vector<Sint32>& FixedSinTable()
+{
+	//built in the initializer, so threads making the first trig call together wait for one build instead of racing
+	static const vector<Sint32> table = BuildFixedSinTable();
+	return table;
+}
+
+GFW::Fixed GFW::FixedSin(int step)
+{
+	const vector<Sint32>& table = FixedSinTable();
+
+	step %= GFW_FIXED_TRIG_STEPS;
+	if (step < 0) {
+		step += GFW_FIXED_TRIG_STEPS;
+	}
+
+	int quadrant = step / QuarterSteps;
+	int i = step % QuarterSteps;
+
+	switch (quadrant) {
+	case 0: return Fixed::FromRaw(table[i]);
+	case 1: return Fixed::FromRaw(table[QuarterSteps - i]);
+	case 2: return Fixed::FromRaw(-table[i]);
+	default: return Fixed::FromRaw(-table[QuarterSteps - i]);
+	}
+}
+
+GFW::Fixed GFW::FixedCos(int step)
+{
+	return FixedSin(step + QuarterSteps);
+}
+
+int GFW::FixedAngleSteps(double angle)
+{
+	//fmod and scaling by a power of two are both exact, so the conversion itself can't differ between machines
+	Sint64 raw = Fixed(fmod(angle, 360.0)).raw;
+	Sint64 fullTurn = static_cast<Sint64>(360) << Fixed::FractionBits;
+
+	raw %= fullTurn;
+	if (raw < 0) {
+		raw += fullTurn;
+	}
+
+	return static_cast<int>((raw * GFW_FIXED_TRIG_STEPS + fullTurn / 2) / fullTurn) % GFW_FIXED_TRIG_STEPS;
+}
+
+const char* GFW::Profiling::PhaseName(FramePhase phase)
+{
+	switch (phase) {
+	case PHASE_INPUT: return "input";
+	case PHASE_UPDATE: return "update";
+	case PHASE_COLLIDE: return "collide";
+	case PHASE_DRAW: return "draw";
+	case PHASE_PRESENT: return "present";
+	default: return "other";
+	}
+}
+
+#ifdef GFW_ALLOC_STATS
+#include <dbghelp.h>
+#include <atomic>
+#pragma comment(lib, "dbghelp.lib")
+
+//everything here lives in zero-initialized static storage so it is usable before any constructors run,
+//and none of it allocates, since it is called from inside operator new
+namespace {
+	const int AllocSiteFrames = 6;
+	const int MaxAllocSites = 4096;
+
+	struct AllocSite {
+		ULONG hash;
+		void* frames[AllocSiteFrames];
+		Uint64 count;
+		Uint64 bytes;
+	};
+
+	//the stack of one allocation, captured by the operator new overload itself (skipping only that frame) so every
+	//overload starts at the caller of new, however the helpers below are inlined
+	struct AllocTrace {
+		void* frames[AllocSiteFrames];
+		ULONG hash;
+	};
+
+	std::atomic<int> allocPhase;
+	std::atomic<bool> allocReporting;
+	//std::mutex isn't constant-initialized on every compiler, and static constructors which run before it allocate
+	SRWLOCK allocLock = SRWLOCK_INIT;
+
+	struct AllocGuard {
+		AllocGuard() { AcquireSRWLockExclusive(&allocLock); }
+		~AllocGuard() { ReleaseSRWLockExclusive(&allocLock); }
+	};
+
+	GFW::Profiling::FrameAllocStats currentFrame, lastFrame;
+	GFW::Profiling::PhaseAllocStats totalAllocs[GFW::Profiling::PHASE_COUNT], maxAllocs[GFW::Profiling::PHASE_COUNT];
+	Uint64 frameCount;
+	AllocSite allocSites[MaxAllocSites];
+	Uint64 droppedSites;
+
+	void RecordAlloc(size_t size, const AllocTrace& trace)
+	{
+		if (allocReporting) {
+			return;
+		}
+
+		const ULONG hash = trace.hash;
+		AllocGuard guard;
+
+		GFW::Profiling::PhaseAllocStats& phase = currentFrame.phases[allocPhase.load()];
+		phase.count++;
+		phase.bytes += size;
+
+		for (int i = 0; i < MaxAllocSites; i++) {
+			AllocSite& site = allocSites[(hash + i) % MaxAllocSites];
+
+			if (site.count == 0) {
+				site.hash = hash;
+				copy(trace.frames, trace.frames + AllocSiteFrames, site.frames);
+			}
+			if (site.hash == hash) {
+				site.count++;
+				site.bytes += size;
+				return;
+			}
+		}
+
+		droppedSites++;
+	}
+
+	void* CountedAlloc(size_t size, const AllocTrace& trace)
+	{
+		RecordAlloc(size, trace);
+
+		void* p = malloc(size == 0 ? 1 : size);
+		if (p == nullptr) {
+			throw bad_alloc();
+		}
+		return p;
+	}
+
+	struct AllocReporter {
+		~AllocReporter() { GFW::Profiling::PrintAllocReport(); }
+	} allocReporter;
+}
+
+void* operator new(size_t size)
 {
-	if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
+	AllocTrace trace = {};
+	CaptureStackBackTrace(1, AllocSiteFrames, trace.frames, &trace.hash);
+	return CountedAlloc(size, trace);
+}
+
+void* operator new[](size_t size)
+{
+	AllocTrace trace = {};
+	CaptureStackBackTrace(1, AllocSiteFrames, trace.frames, &trace.hash);
+	return CountedAlloc(size, trace);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+	AllocTrace trace = {};
+	CaptureStackBackTrace(1, AllocSiteFrames, trace.frames, &trace.hash);
+	RecordAlloc(size, trace);
+	return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+	AllocTrace trace = {};
+	CaptureStackBackTrace(1, AllocSiteFrames, trace.frames, &trace.hash);
+	RecordAlloc(size, trace);
+	return malloc(size == 0 ? 1 : size);
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const nothrow_t&) noexcept { free(p); }
+
+GFW::Profiling::FramePhase GFW::Profiling::SetPhase(FramePhase phase)
+{
+	return static_cast<FramePhase>(allocPhase.exchange(phase));
+}
+
+void GFW::Profiling::EndFrame()
+{
+	AllocGuard guard;
+
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		PhaseAllocStats& phase = currentFrame.phases[i];
+
+		totalAllocs[i].count += phase.count;
+		totalAllocs[i].bytes += phase.bytes;
+		maxAllocs[i].count = max(maxAllocs[i].count, phase.count);
+		maxAllocs[i].bytes = max(maxAllocs[i].bytes, phase.bytes);
+	}
+
+	lastFrame = currentFrame;
+	currentFrame = FrameAllocStats();
+	frameCount++;
+}
+
+GFW::Profiling::FrameAllocStats GFW::Profiling::GetLastFrameAllocStats()
+{
+	AllocGuard guard;
+	return lastFrame;
+}
+
+void GFW::Profiling::PrintAllocReport()
+{
+	const int topSites = 10;
+
+	//the symbol lookups below allocate, those allocations shouldn't show up in the report
+	allocReporting = true;
+
+	AllocGuard guard;
+
+	printf("allocations over %" SDL_PRIu64 " frames:\n", frameCount);
+	printf("  %-8s %12s %12s %12s %12s\n", "phase", "avg count", "avg bytes", "max count", "max bytes");
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		Uint64 frames = max<Uint64>(frameCount, 1);
+		printf("  %-8s %12" SDL_PRIu64 " %12" SDL_PRIu64 " %12" SDL_PRIu64 " %12" SDL_PRIu64 "\n", PhaseName(static_cast<FramePhase>(i)),
+			totalAllocs[i].count / frames, totalAllocs[i].bytes / frames, maxAllocs[i].count, maxAllocs[i].bytes);
+	}
+
+	HANDLE process = GetCurrentProcess();
+	SymSetOptions(SYMOPT_LOAD_LINES | SYMOPT_UNDNAME);
+	SymInitialize(process, NULL, TRUE);
+
+	printf("top allocation sites:\n");
+	bool printed[MaxAllocSites] = {};
+	for (int n = 0; n < topSites; n++) {
+		int best = -1;
+		for (int i = 0; i < MaxAllocSites; i++) {
+			if (!printed[i] && allocSites[i].count != 0 && (best == -1 || allocSites[i].count > allocSites[best].count)) {
+				best = i;
+			}
+		}
+		if (best == -1) {
+			break;
+		}
+		printed[best] = true;
+
+		AllocSite& site = allocSites[best];
+		printf("  %" SDL_PRIu64 " allocations, %" SDL_PRIu64 " bytes\n", site.count, site.bytes);
+
+		for (void* frame : site.frames) {
+			if (frame == nullptr) {
+				break;
+			}
+
+			char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME] = {};
+			SYMBOL_INFO* symbol = reinterpret_cast<SYMBOL_INFO*>(buffer);
+			symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+			symbol->MaxNameLen = MAX_SYM_NAME;
+			DWORD64 displacement = 0;
+			IMAGEHLP_LINE64 line = {};
+			line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
+			DWORD lineDisplacement = 0;
+
+			if (!SymFromAddr(process, reinterpret_cast<DWORD64>(frame), &displacement, symbol)) {
+				printf("    %p\n", frame);
+			}
+			else if (SymGetLineFromAddr64(process, reinterpret_cast<DWORD64>(frame), &lineDisplacement, &line)) {
+				printf("    %s (%s:%lu)\n", symbol->Name, line.FileName, line.LineNumber);
+			}
+			else {
+				printf("    %s\n", symbol->Name);
+			}
+		}
+	}
+	if (droppedSites != 0) {
+		printf("  (%" SDL_PRIu64 " allocations from untracked sites)\n", droppedSites);
+	}
+
+	SymCleanup(process);
+}
+#endif
+
+GFW::Inst::Inst(bool headless)
+{
+	//without a display (or sound card) the video and audio subsystems fail to start
+	Uint32 flags = headless ? SDL_INIT_TIMER | SDL_INIT_EVENTS : SDL_INIT_EVERYTHING;
+
+	if (SDL_Init(flags) != 0) {
 		exit(1);
 	}
 	running = true;
@@ -44,10 +367,52 @@ void GFW::Inst::WRinit(string winT, int sw, int sh)
 		exit(1);
 	}
 
-	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+	SDL_GetRendererOutputSize(renderer, &screenW, &screenH);
+	camera.SetScreenSize(screenW, screenH);
+
+	stateTracker.Attach(renderer);
+	stateTracker.SetBlendMode(SDL_BLENDMODE_BLEND);
 	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
 }
 
+void GFW::Inst::HeadlessInit(int sw, int sh)
+{
+	frameSurface = SDL_CreateRGBSurfaceWithFormat(0, sw, sh, 32, SDL_PIXELFORMAT_ARGB8888);
+
+	if (!frameSurface) {
+		gerror_print();
+		exit(1);
+	}
+
+	renderer = SDL_CreateSoftwareRenderer(frameSurface);
+
+	if (!renderer) {
+		gerror_print();
+		exit(1);
+	}
+
+	screenW = sw;
+	screenH = sh;
+	camera.SetScreenSize(screenW, screenH);
+
+	stateTracker.Attach(renderer);
+	stateTracker.SetBlendMode(SDL_BLENDMODE_BLEND);
+}
+
+bool GFW::Inst::ReadFrame(vector<Uint32>& pixels)
+{
+	pixels.resize(static_cast<size_t>(screenW) * screenH);
+
+	//the state tracker may have left a texture as the target
+	stateTracker.SetTarget(nullptr);
+
+	if (SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, pixels.data(), screenW * static_cast<int>(sizeof(Uint32))) != 0) {
+		gerror_print();
+		return false;
+	}
+	return true;
+}
+
 void GFW::Inst::gerror_print()
 {
 	cerr << "error: " << SDL_GetError() << endl;
@@ -80,6 +445,8 @@ void GFW::Inst::unbind_input(SDL_EventType binding_event)
 
 void GFW::Inst::gInput()
 {
+	Profiling::PhaseScope phase(Profiling::PHASE_INPUT);
+
 	if (SDL_PollEvent(&e)) {
 		pInput(e);
 	}
@@ -87,7 +454,7 @@ void GFW::Inst::gInput()
 
 void GFW::Inst::pInput(SDL_Event e)
 {
-	for (pair<SDL_EventType, function<void(void)>> input : inputs) {
+	for (const pair<SDL_EventType, function<void(void)>>& input : inputs) {
 		if (e.type == input.first) {
 			input.second();
 		}
@@ -102,318 +469,5272 @@ void GFW::Inst::pInput(SDL_Event e)
 
 void GFW::Inst::prep()
 {
+	Profiling::SetPhase(Profiling::PHASE_DRAW);
+
+	if (softRaster != nullptr) {
+		softRaster->Clear(backgroundColor);
+		return;
+	}
+
+	//in dirty rect mode only the damaged areas are cleared, by pres()
+	if (dirtyRects) {
+		return;
+	}
+
 	GFW_SetRenderDrawColor(renderer, backgroundColor);
 	SDL_RenderClear(renderer);
 }
 
 void GFW::Inst::pres()
 {
-	SDL_RenderPresent(renderer);
-}
+	renderQueue.Flush(renderer, &camera);
+	renderQueue.EndFrame();
 
-GFW::Image::Image GFW::Image::CreateImg(string img_path, SDL_Renderer* renderer)
-{
-	Image img;
-	SDL_Surface* temp = IMG_Load(img_path.c_str());
+	if (softRaster != nullptr) {
+		softRaster->Present(renderer);
+	}
+	else if (dirtyRects) {
+		stateTracker.SetTarget(frameTarget);
+		damageTracker.Redraw(renderer, stateTracker, backgroundColor, { 0, 0, screenW, screenH }, &camera);
+		stateTracker.SetTarget(nullptr);
+		SDL_RenderCopy(renderer, frameTarget, NULL, NULL);
+	}
 
-	img.texture = SDL_CreateTextureFromSurface(renderer, temp);
+	if (!postProcess.IsEmpty()) {
+		postProcess.Apply(renderer, screenW, screenH);
+	}
 
-	SDL_FreeSurface(temp);
+	//outlines are drawn on top of the finished frame (and outside of the dirty rect target)
+	debugBatch.Flush(renderer);
 
-	int width, height;
+	if (frameCapture.IsRunning()) {
+		frameCapture.Capture(renderer, screenW, screenH);
+	}
 
-	SDL_QueryTexture(img.texture, nullptr, nullptr, &width, &height);
+	Profiling::SetPhase(Profiling::PHASE_PRESENT);
 
-	img.rect.w = width;
-	img.rect.h = height;
+	SDL_RenderPresent(renderer);
 
+	lastCullStats = cullStats;
+	cullStats = Render::CullStats();
 
-	return img;
+	Profiling::EndFrame();
+	Profiling::SetPhase(Profiling::PHASE_OTHER);
 }
 
-void GFW::Inst::Delay()
+SDL_BlendMode GFW::Image::PremultipliedBlendMode()
 {
-	FrameDelay = 1000 / FPS;
-	FrameTime = SDL_GetTicks() - FrameStart;
+	return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+		SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+}
 
-	if (FrameDelay > FrameTime) {
-		SDL_Delay(FrameDelay - FrameTime);
+//the first format the renderer lists with (or without) alpha, which is the one SDL_CreateTextureFromSurface picks too
+static Uint32 NativeFormat(SDL_Renderer* renderer, bool alpha)
+{
+	SDL_RendererInfo info;
+
+	if (SDL_GetRendererInfo(renderer, &info) == 0) {
+		for (Uint32 i = 0; i < info.num_texture_formats; i++) {
+			Uint32 format = info.texture_formats[i];
+
+			if (!SDL_ISPIXELFORMAT_FOURCC(format) && SDL_ISPIXELFORMAT_ALPHA(format) == alpha) {
+				return format;
+			}
+		}
 	}
+	return alpha ? SDL_PIXELFORMAT_ARGB8888 : SDL_PIXELFORMAT_RGB888;
 }
 
-
-GFW::Points::Points GFW::Points::GetRectBounds(SDL_Rect rect)
+//whether a kind of renderer can blend premultiplied alpha, found once per backend by trying it on a tiny texture
+static bool SupportsPremultiplied(SDL_Renderer* renderer)
 {
-	Points ret;
+	static unordered_map<string, bool> supported;
 
-	ret.v.push_back({rect.x, rect.y});
-	ret.v.push_back({rect.x + rect.w, rect.y});
-	ret.v.push_back({rect.x + rect.w, rect.y + rect.h});
-	ret.v.push_back({rect.x, rect.y + rect.h});
-	ret.midp.x = rect.x + (rect.w / 2);
-	ret.midp.y = rect.y + (rect.h / 2);
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(renderer, &info) != 0) {
+		return false;
+	}
 
-	return ret;
+	auto found = supported.find(info.name);
+	if (found != supported.end()) {
+		return found->second;
+	}
+
+	SDL_Texture* probe = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 1, 1);
+	bool result = probe != nullptr && SDL_SetTextureBlendMode(probe, GFW::Image::PremultipliedBlendMode()) == 0;
+
+	if (probe != nullptr) {
+		SDL_DestroyTexture(probe);
+	}
+
+	supported[info.name] = result;
+	return result;
 }
 
+//calls visit with each pixel of a 32 bit surface, and its alpha unpacked
+template<typename Visit>
+static void ForEachPixel(SDL_Surface* surface, Visit visit)
+{
+	SDL_LockSurface(surface);
+
+	const SDL_PixelFormat* format = surface->format;
+	for (int y = 0; y < surface->h; y++) {
+		Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch);
+
+		for (int x = 0; x < surface->w; x++) {
+			visit(row[x], (row[x] & format->Amask) >> format->Ashift);
+		}
+	}
 
+	SDL_UnlockSurface(surface);
+}
 
-bool GFW::Collision::detectCollision(Points::Points a, Points::Points b)
+//divides the colors of an ARGB8888 surface by their alpha, turning premultiplied pixels into straight alpha ones
+static void Unpremultiply(SDL_Surface* surface)
 {
-	bool check1 = checkshape_SATalg(a, b);
-	bool check2 = checkshape_SATalg(b, a);
+	ForEachPixel(surface, [](Uint32& pixel, Uint32 alpha) {
+		if (alpha == 0 || alpha == 255) {
+			return;
+		}
 
-	return check1 && check2;
+		auto scale = [pixel, alpha](int shift) {
+			Uint32 c = (pixel >> shift) & 0xFF;
+			return min<Uint32>(255, (c * 255 + alpha / 2) / alpha) << shift;
+		};
+		pixel = (pixel & 0xFF000000) | scale(16) | scale(8) | scale(0);
+	});
 }
 
-//credit goes to javidx9
-//this algoritim still has same bugs
-bool GFW::Collision::checkshape_Dalg(Points::Points p1, Points::Points p2)
+SDL_Texture* GFW::Image::CreateTexture(SDL_Surface* surface, SDL_Renderer* renderer)
 {
-	for (int p = 0; p < p1.v.size(); p++) {
-		FVector2D line_r1s;
-		FVector2D line_r1e;
-		line_r1s = p1.midp;
-		line_r1e = p1.v[p];
+	if (surface == nullptr) {
+		return nullptr;
+	}
 
-		for (int q = 0; q < p2.v.size(); q++) {
-			FVector2D line_r2s;
-			FVector2D line_r2e;
+	bool alpha = surface->format->Amask != 0 || SDL_HasColorKey(surface);
+	SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, NativeFormat(renderer, alpha), 0);
 
-			line_r2s = p2.v[q];
-			line_r2e = p2.v[(q + 1) % p2.v.size()];
+	if (converted == nullptr) {
+		cerr << "error: " << SDL_GetError() << endl;
+		return nullptr;
+	}
 
+	//an alpha channel which is opaque everywhere only costs blending
+	if (alpha && converted->format->BytesPerPixel == 4) {
+		bool opaque = true;
+		ForEachPixel(converted, [&opaque](Uint32&, Uint32 a) { opaque = opaque && a == 255; });
 
-			float h = (line_r2e.x - line_r2s.x) * (line_r1s.y - line_r1e.y) - (line_r1s.x - line_r1e.x) * (line_r2e.y - line_r2s.y);
-			float t1 = ((line_r2s.y - line_r2e.y) * (line_r1s.x - line_r2s.x) + (line_r2e.x - line_r2s.x) * (line_r1s.y - line_r2s.y)) / h;
-			float t2 = ((line_r1s.y - line_r1e.y) * (line_r1s.x - line_r2s.x) + (line_r1e.x - line_r1s.x) * (line_r1s.y - line_r2s.y)) / h;
+		if (opaque) {
+			SDL_FreeSurface(converted);
+			converted = SDL_ConvertSurfaceFormat(surface, NativeFormat(renderer, false), 0);
+			alpha = false;
 
-			if (t1 >= 0.0f && t1 < 1.0f && t2 >= 0.0f && t2 < 1.0f)
-			{
-				return true;
+			if (converted == nullptr) {
+				cerr << "error: " << SDL_GetError() << endl;
+				return nullptr;
 			}
+		}
+	}
 
+	bool premultiply = alpha && converted->format->BytesPerPixel == 4 && SupportsPremultiplied(renderer);
 
-		}
+	if (premultiply) {
+		const SDL_PixelFormat* format = converted->format;
+		Uint32 rgbMask = format->Rmask | format->Gmask | format->Bmask;
 
+		ForEachPixel(converted, [format, rgbMask](Uint32& pixel, Uint32 a) {
+			if (a == 255) {
+				return;
+			}
 
+			auto scale = [pixel, a](Uint32 mask, Uint8 shift) {
+				Uint32 c = (pixel & mask) >> shift;
+				return ((c * a + 127) / 255) << shift;
+			};
+			pixel = (pixel & ~rgbMask) | scale(format->Rmask, format->Rshift) | scale(format->Gmask, format->Gshift) | scale(format->Bmask, format->Bshift);
+		});
 	}
-	return false;
+
+	//the surface already has the texture's format, so this is a straight upload
+	SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, converted);
+	SDL_FreeSurface(converted);
+
+	if (texture == nullptr) {
+		cerr << "error: " << SDL_GetError() << endl;
+		return nullptr;
+	}
+
+	SDL_SetTextureBlendMode(texture, !alpha ? SDL_BLENDMODE_NONE : premultiply ? PremultipliedBlendMode() : SDL_BLENDMODE_BLEND);
+
+	//the software renderer blends straight alpha, so it gets the original pixels
+	Render::SoftwareRenderer::CaptureTexture(renderer, texture, surface);
+
+	return texture;
 }
 
-//credit goes to javidx9
-//use this it works
-bool GFW::Collision::checkshape_SATalg(Points::Points p1, Points::Points p2)
+string GFW::Image::TextureCache::Canonical(const string& path)
 {
-	for (int a = 0; a < p1.v.size(); a++)
-	{
-		int b = (a + 1) % p1.v.size();
-		FVector2D axisProj = { static_cast<float>(-(p1.v[b].y - p1.v[a].y)), static_cast<float>(p1.v[b].x - p1.v[a].x) };
-		float d = sqrtf(axisProj.x * axisProj.x + axisProj.y * axisProj.y);
-		axisProj = { axisProj.x / d, axisProj.y / d};
+	string unified = path;
+	replace(unified.begin(), unified.end(), '\\', '/');
 
-		float min_r1 = INFINITY, max_r1 = -INFINITY;
-		for (int p = 0; p < p1.v.size(); p++)
-		{
-			float q = (p1.v[p].x * axisProj.x + p1.v[p].y * axisProj.y);
-			min_r1 = min(min_r1, q);
-			max_r1 = max(max_r1, q);
-		}
+	bool absolute = !unified.empty() && unified[0] == '/';
+	vector<string> parts;
+	size_t begin = 0;
 
-		float min_r2 = INFINITY, max_r2 = -INFINITY;
-		for (int p = 0; p < p2.v.size(); p++)
-		{
-			float q = (p2.v[p].x * axisProj.x + p2.v[p].y * axisProj.y);
-			min_r2 = min(min_r2, q);
-			max_r2 = max(max_r2, q);
+	while (begin <= unified.size()) {
+		size_t end = unified.find('/', begin);
+		if (end == string::npos) {
+			end = unified.size();
 		}
 
-		if (!(max_r2 >= min_r1 && max_r1 >= min_r2)) {
-			return false;
+		string part = unified.substr(begin, end - begin);
+		begin = end + 1;
+
+		if (part.empty() || part == ".") {
+			continue;
+		}
+		//a ".." above the start of a relative path (or a drive) has to be kept
+		if (part == ".." && !parts.empty() && parts.back() != ".." && parts.back().back() != ':') {
+			parts.pop_back();
+		}
+		else if (part != ".." || !absolute) {
+			parts.push_back(part);
 		}
 	}
-	return true;
+
+	string canonical = absolute ? "/" : "";
+	for (size_t i = 0; i < parts.size(); i++) {
+		canonical += (i > 0 ? "/" : "") + parts[i];
+	}
+	return canonical.empty() ? "." : canonical;
+}
+
+GFW::Image::TextureCache::Handle::Handle(const Handle& other) : cache(other.cache), entry(other.entry)
+{
+	if (entry != nullptr) {
+		entry->refs++;
+	}
+}
+
+GFW::Image::TextureCache::Handle& GFW::Image::TextureCache::Handle::operator=(const Handle& other)
+{
+	//referenced before this handle lets go, since other may be this handle (or hold its last reference)
+	TextureCache* otherCache = other.cache;
+	Entry* otherEntry = other.entry;
+
+	if (otherEntry != nullptr) {
+		otherEntry->refs++;
+	}
+	Reset();
+	cache = otherCache;
+	entry = otherEntry;
+	return *this;
+}
+
+SDL_Texture* GFW::Image::TextureCache::Handle::Get() const
+{
+	return entry != nullptr ? entry->texture : nullptr;
+}
+
+void GFW::Image::TextureCache::Handle::Reset()
+{
+	if (entry != nullptr && --entry->refs == 0) {
+		//an entry whose cache was cleared only belongs to its handles
+		if (entry->texture != nullptr) {
+			cache->Drop(entry);
+		}
+		else {
+			delete entry;
+		}
+	}
+	cache = nullptr;
+	entry = nullptr;
+}
+
+GFW::Image::TextureCache::~TextureCache()
+{
+	//the renderer is usually gone by now, so the textures are left to it and only the handles are cut loose
+	Orphan();
+}
+
+GFW::Image::TextureCache::Handle GFW::Image::TextureCache::Acquire(string img_path, SDL_Renderer* renderer)
+{
+	Key key = { renderer, Canonical(img_path) };
+
+	auto found = entries.find(key);
+	if (found != entries.end()) {
+		hits++;
+		found->second->refs++;
+		return Handle(this, found->second);
+	}
+	misses++;
+
+	//the canonical path is only a key, folding ".." lexically is wrong for UNC paths and symlinks
+	SDL_Surface* temp = IMG_Load(img_path.c_str());
+
+	if (temp == nullptr) {
+		cerr << "error: " << IMG_GetError() << endl;
+		return Handle();
+	}
+
+	SDL_Texture* texture = CreateTexture(temp, renderer);
+	size_t bytes = static_cast<size_t>(temp->w) * temp->h * 4;
+	SDL_FreeSurface(temp);
+
+	if (texture == nullptr) {
+		return Handle();
+	}
+
+	Entry* entry = new Entry{ texture, 1, bytes, key };
+	entries[key] = entry;
+	keys[texture] = entry;
+	usage += bytes;
+
+	return Handle(this, entry);
+}
+
+void GFW::Image::TextureCache::Drop(Entry* entry)
+{
+	Render::SoftwareRenderer::ReleaseTexture(entry->texture);
+	SDL_DestroyTexture(entry->texture);
+	usage -= entry->bytes;
+	entries.erase(entry->key);
+	keys.erase(entry->texture);
+	delete entry;
+}
+
+int GFW::Image::TextureCache::GetRefCount(SDL_Texture* texture)
+{
+	auto found = keys.find(texture);
+	return found != keys.end() ? found->second->refs : 0;
+}
+
+void GFW::Image::TextureCache::Orphan()
+{
+	//every entry is still referenced (it is dropped with its last reference), so its handles delete it
+	for (auto& entry : entries) {
+		entry.second->texture = nullptr;
+	}
+	entries.clear();
+	keys.clear();
+	usage = 0;
+}
+
+void GFW::Image::TextureCache::Clear()
+{
+	for (auto& entry : entries) {
+		Render::SoftwareRenderer::ReleaseTexture(entry.second->texture);
+		SDL_DestroyTexture(entry.second->texture);
+	}
+	Orphan();
+}
+
+GFW::Image::Image GFW::Image::CreateImg(string img_path, SDL_Renderer* renderer)
+{
+	Image img;
+	img.textureRef = Image::textureCache.Acquire(img_path, renderer);
+	img.texture = img.textureRef.Get();
+
+	int width, height;
+
+	SDL_QueryTexture(img.texture, nullptr, nullptr, &width, &height);
+
+	img.rect.w = width;
+	img.rect.h = height;
+
+
+	return img;
+}
+
+void GFW::Inst::Delay()
+{
+	//headless frames are rendered as fast as possible, for benchmarks and batch output
+	if (frameSurface != nullptr) {
+		return;
+	}
+
+	FrameDelay = 1000 / FPS;
+	FrameTime = SDL_GetTicks() - FrameStart;
+
+	if (FrameDelay > FrameTime) {
+		SDL_Delay(FrameDelay - FrameTime);
+	}
+}
+
+
+GFW::Points::Points GFW::Points::GetRectBounds(SDL_Rect rect)
+{
+	Points ret;
+
+	ret.v.push_back({rect.x, rect.y});
+	ret.v.push_back({rect.x + rect.w, rect.y});
+	ret.v.push_back({rect.x + rect.w, rect.y + rect.h});
+	ret.v.push_back({rect.x, rect.y + rect.h});
+	ret.midp.x = rect.x + (rect.w / 2);
+	ret.midp.y = rect.y + (rect.h / 2);
+
+	return ret;
+}
+
+
+
+bool GFW::Collision::detectCollision(const Points::Points& a, const Points::Points& b)
+{
+	Profiling::PhaseScope phase(Profiling::PHASE_COLLIDE);
+
+	bool check1 = checkshape_SATalg(a, b);
+	bool check2 = checkshape_SATalg(b, a);
+
+	return check1 && check2;
+}
+
+//credit goes to javidx9
+//this algoritim still has same bugs
+bool GFW::Collision::checkshape_Dalg(const Points::Points& p1, const Points::Points& p2)
+{
+	for (int p = 0; p < p1.v.size(); p++) {
+#ifdef GFW_FIXED_POINT
+		//the points are integers, so the intersection test can be done exactly without any division
+		Sint64 r1sx = p1.midp.x, r1sy = p1.midp.y;
+		Sint64 r1ex = p1.v[p].x, r1ey = p1.v[p].y;
+
+		for (int q = 0; q < p2.v.size(); q++) {
+			Sint64 r2sx = p2.v[q].x, r2sy = p2.v[q].y;
+			Sint64 r2ex = p2.v[(q + 1) % p2.v.size()].x, r2ey = p2.v[(q + 1) % p2.v.size()].y;
+
+			Sint64 h = (r2ex - r2sx) * (r1sy - r1ey) - (r1sx - r1ex) * (r2ey - r2sy);
+			Sint64 n1 = (r2sy - r2ey) * (r1sx - r2sx) + (r2ex - r2sx) * (r1sy - r2sy);
+			Sint64 n2 = (r1sy - r1ey) * (r1sx - r2sx) + (r1ex - r1sx) * (r1sy - r2sy);
+
+			if (h < 0) {
+				h = -h; n1 = -n1; n2 = -n2;
+			}
+
+			if (h != 0 && n1 >= 0 && n1 < h && n2 >= 0 && n2 < h)
+			{
+				return true;
+			}
+		}
+#else
+		FVector2D line_r1s;
+		FVector2D line_r1e;
+		line_r1s = p1.midp;
+		line_r1e = p1.v[p];
+
+		for (int q = 0; q < p2.v.size(); q++) {
+			FVector2D line_r2s;
+			FVector2D line_r2e;
+
+			line_r2s = p2.v[q];
+			line_r2e = p2.v[(q + 1) % p2.v.size()];
+
+
+			float h = (line_r2e.x - line_r2s.x) * (line_r1s.y - line_r1e.y) - (line_r1s.x - line_r1e.x) * (line_r2e.y - line_r2s.y);
+			float t1 = ((line_r2s.y - line_r2e.y) * (line_r1s.x - line_r2s.x) + (line_r2e.x - line_r2s.x) * (line_r1s.y - line_r2s.y)) / h;
+			float t2 = ((line_r1s.y - line_r1e.y) * (line_r1s.x - line_r2s.x) + (line_r1e.x - line_r1s.x) * (line_r1s.y - line_r2s.y)) / h;
+
+			if (t1 >= 0.0f && t1 < 1.0f && t2 >= 0.0f && t2 < 1.0f)
+			{
+				return true;
+			}
+
+
+		}
+#endif
+
+
+	}
+	return false;
+}
+
+//credit goes to javidx9
+//use this it works
+bool GFW::Collision::checkshape_SATalg(const Points::Points& p1, const Points::Points& p2)
+{
+	for (int a = 0; a < p1.v.size(); a++)
+	{
+		int b = (a + 1) % p1.v.size();
+#ifdef GFW_FIXED_POINT
+		//the overlap test doesn't depend on the length of the axis, so it is left unnormalized and projected exactly
+		Sint64 axisX = -(p1.v[b].y - p1.v[a].y);
+		Sint64 axisY = p1.v[b].x - p1.v[a].x;
+
+		Sint64 min_r1 = INT64_MAX, max_r1 = INT64_MIN;
+		for (int p = 0; p < p1.v.size(); p++)
+		{
+			Sint64 q = p1.v[p].x * axisX + p1.v[p].y * axisY;
+			min_r1 = min(min_r1, q);
+			max_r1 = max(max_r1, q);
+		}
+
+		Sint64 min_r2 = INT64_MAX, max_r2 = INT64_MIN;
+		for (int p = 0; p < p2.v.size(); p++)
+		{
+			Sint64 q = p2.v[p].x * axisX + p2.v[p].y * axisY;
+			min_r2 = min(min_r2, q);
+			max_r2 = max(max_r2, q);
+		}
+#else
+		FVector2D axisProj = { static_cast<float>(-(p1.v[b].y - p1.v[a].y)), static_cast<float>(p1.v[b].x - p1.v[a].x) };
+		float d = sqrtf(axisProj.x * axisProj.x + axisProj.y * axisProj.y);
+		axisProj = FVector2D(axisProj.x / d, axisProj.y / d);
+
+		float min_r1 = INFINITY, max_r1 = -INFINITY;
+		for (int p = 0; p < p1.v.size(); p++)
+		{
+			float q = (p1.v[p].x * axisProj.x + p1.v[p].y * axisProj.y);
+			min_r1 = min(min_r1, q);
+			max_r1 = max(max_r1, q);
+		}
+
+		float min_r2 = INFINITY, max_r2 = -INFINITY;
+		for (int p = 0; p < p2.v.size(); p++)
+		{
+			float q = (p2.v[p].x * axisProj.x + p2.v[p].y * axisProj.y);
+			min_r2 = min(min_r2, q);
+			max_r2 = max(max_r2, q);
+		}
+#endif
+
+		if (!(max_r2 >= min_r1 && max_r1 >= min_r2)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//projects both vertex lists onto the edge normals of the first one, exactly, in 64 bit integers
+static bool SeparatedOnAxesOf(const GFW::Vector2D* a, int na, const GFW::Vector2D* b, int nb)
+{
+	for (int i = 0; i < na; i++) {
+		int j = (i + 1) % na;
+		Sint64 axisX = -(a[j].y - a[i].y);
+		Sint64 axisY = a[j].x - a[i].x;
+
+		Sint64 min_a = INT64_MAX, max_a = INT64_MIN;
+		for (int p = 0; p < na; p++) {
+			Sint64 q = a[p].x * axisX + a[p].y * axisY;
+			min_a = min(min_a, q);
+			max_a = max(max_a, q);
+		}
+
+		Sint64 min_b = INT64_MAX, max_b = INT64_MIN;
+		for (int p = 0; p < nb; p++) {
+			Sint64 q = b[p].x * axisX + b[p].y * axisY;
+			min_b = min(min_b, q);
+			max_b = max(max_b, q);
+		}
+
+		if (!(max_b >= min_a && max_a >= min_b)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool PolygonsOverlap(const GFW::Vector2D* a, int na, const GFW::Vector2D* b, int nb)
+{
+	//an empty polygon (an Image whose bounds were never updated) has no axes to separate on, but covers nothing
+	if (na == 0 || nb == 0) {
+		return false;
+	}
+	return !SeparatedOnAxesOf(a, na, b, nb) && !SeparatedOnAxesOf(b, nb, a, na);
+}
+
+static bool PolygonCircleOverlap(const GFW::Vector2D* v, int n, GFW::Vector2D c, int r)
+{
+	Sint64 r2 = static_cast<Sint64>(r) * r;
+	bool inside = true;
+	int side = 0;
+
+	for (int i = 0; i < n; i++) {
+		const GFW::Vector2D& a = v[i];
+		const GFW::Vector2D& b = v[(i + 1) % n];
+		Sint64 abx = b.x - a.x, aby = b.y - a.y;
+		Sint64 apx = c.x - a.x, apy = c.y - a.y;
+
+		//distance from the center to this edge, compared squared so no division or sqrt is needed
+		Sint64 t = apx * abx + apy * aby;
+		Sint64 len2 = abx * abx + aby * aby;
+		Sint64 cross = abx * apy - aby * apx;
+
+		if (t <= 0 || len2 == 0) {
+			if (apx * apx + apy * apy <= r2) return true;
+		}
+		else if (t >= len2) {
+			Sint64 bpx = c.x - b.x, bpy = c.y - b.y;
+			if (bpx * bpx + bpy * bpy <= r2) return true;
+		}
+		else if (cross * cross <= r2 * len2) {
+			return true;
+		}
+
+		//the center is inside if it is on the same side of every edge
+		int s = (cross > 0) - (cross < 0);
+		if (s != 0) {
+			if (side == 0) side = s;
+			else if (s != side) inside = false;
+		}
+	}
+
+	return inside && n > 0;
+}
+
+static void AABBCorners(const GFW::Collision::AABB& a, GFW::Vector2D corners[4])
+{
+	corners[0] = { a.x, a.y };
+	corners[1] = { a.x + a.w, a.y };
+	corners[2] = { a.x + a.w, a.y + a.h };
+	corners[3] = { a.x, a.y + a.h };
+}
+
+GFW::Collision::OBB::OBB(const SDL_Rect& rect, double angle)
+{
+	Vector2D center = { rect.x + rect.w / 2, rect.y + rect.h / 2 };
+
+	corners[0] = Points::RotatePoint(center, { rect.x, rect.y }, angle);
+	corners[1] = Points::RotatePoint(center, { rect.x + rect.w, rect.y }, angle);
+	corners[2] = Points::RotatePoint(center, { rect.x + rect.w, rect.y + rect.h }, angle);
+	corners[3] = Points::RotatePoint(center, { rect.x, rect.y + rect.h }, angle);
+}
+
+bool GFW::Collision::Collider<GFW::Collision::AABB, GFW::Collision::OBB>::Test(const AABB& a, const OBB& b)
+{
+	Vector2D corners[4];
+	AABBCorners(a, corners);
+	return PolygonsOverlap(corners, 4, b.corners, 4);
+}
+
+bool GFW::Collision::Collider<GFW::Collision::AABB, GFW::Collision::CircleShape>::Test(const AABB& a, const CircleShape& b)
+{
+	Sint64 dx = b.center.x - max(a.x, min(b.center.x, a.x + a.w));
+	Sint64 dy = b.center.y - max(a.y, min(b.center.y, a.y + a.h));
+	return dx * dx + dy * dy <= static_cast<Sint64>(b.r) * b.r;
+}
+
+bool GFW::Collision::Collider<GFW::Collision::AABB, GFW::Collision::ConvexPoly>::Test(const AABB& a, const ConvexPoly& b)
+{
+	Vector2D corners[4];
+	AABBCorners(a, corners);
+	return PolygonsOverlap(corners, 4, b.v, b.count);
+}
+
+bool GFW::Collision::Collider<GFW::Collision::OBB, GFW::Collision::OBB>::Test(const OBB& a, const OBB& b)
+{
+	return PolygonsOverlap(a.corners, 4, b.corners, 4);
+}
+
+bool GFW::Collision::Collider<GFW::Collision::OBB, GFW::Collision::CircleShape>::Test(const OBB& a, const CircleShape& b)
+{
+	return PolygonCircleOverlap(a.corners, 4, b.center, b.r);
+}
+
+bool GFW::Collision::Collider<GFW::Collision::OBB, GFW::Collision::ConvexPoly>::Test(const OBB& a, const ConvexPoly& b)
+{
+	return PolygonsOverlap(a.corners, 4, b.v, b.count);
+}
+
+bool GFW::Collision::Collider<GFW::Collision::CircleShape, GFW::Collision::CircleShape>::Test(const CircleShape& a, const CircleShape& b)
+{
+	Sint64 dx = a.center.x - b.center.x;
+	Sint64 dy = a.center.y - b.center.y;
+	Sint64 r = static_cast<Sint64>(a.r) + b.r;
+	return dx * dx + dy * dy <= r * r;
+}
+
+bool GFW::Collision::Collider<GFW::Collision::CircleShape, GFW::Collision::ConvexPoly>::Test(const CircleShape& a, const ConvexPoly& b)
+{
+	return PolygonCircleOverlap(b.v, b.count, a.center, a.r);
+}
+
+bool GFW::Collision::Collider<GFW::Collision::ConvexPoly, GFW::Collision::ConvexPoly>::Test(const ConvexPoly& a, const ConvexPoly& b)
+{
+	return PolygonsOverlap(a.v, a.count, b.v, b.count);
+}
+
+namespace {
+	using namespace GFW::Collision;
+
+	const AABB& Unwrap(const AnyShape& s, const AABB*) { return s.aabb; }
+	const OBB& Unwrap(const AnyShape& s, const OBB*) { return s.obb; }
+	const CircleShape& Unwrap(const AnyShape& s, const CircleShape*) { return s.circle; }
+	const ConvexPoly& Unwrap(const AnyShape& s, const ConvexPoly*) { return s.poly; }
+
+	template<typename A, typename B>
+	bool ErasedTest(const AnyShape& a, const AnyShape& b)
+	{
+		return Collider<A, B>::Test(Unwrap(a, static_cast<const A*>(nullptr)), Unwrap(b, static_cast<const B*>(nullptr)));
+	}
+
+	typedef bool (*ErasedTestFn)(const AnyShape&, const AnyShape&);
+
+	//indexed by [ShapeKind][ShapeKind], in the order the kinds are declared
+	constexpr ErasedTestFn dispatchTable[SHAPE_KIND_COUNT][SHAPE_KIND_COUNT] = {
+		{ &ErasedTest<AABB, AABB>, &ErasedTest<AABB, OBB>, &ErasedTest<AABB, CircleShape>, &ErasedTest<AABB, ConvexPoly> },
+		{ &ErasedTest<OBB, AABB>, &ErasedTest<OBB, OBB>, &ErasedTest<OBB, CircleShape>, &ErasedTest<OBB, ConvexPoly> },
+		{ &ErasedTest<CircleShape, AABB>, &ErasedTest<CircleShape, OBB>, &ErasedTest<CircleShape, CircleShape>, &ErasedTest<CircleShape, ConvexPoly> },
+		{ &ErasedTest<ConvexPoly, AABB>, &ErasedTest<ConvexPoly, OBB>, &ErasedTest<ConvexPoly, CircleShape>, &ErasedTest<ConvexPoly, ConvexPoly> },
+	};
+}
+
+bool GFW::Collision::Intersects(const AnyShape& a, const AnyShape& b)
+{
+	if (a.kind == SHAPE_NONE || b.kind == SHAPE_NONE) {
+		return false;
+	}
+
+	Profiling::PhaseScope phase(Profiling::PHASE_COLLIDE);
+
+	return dispatchTable[a.kind][b.kind](a, b);
+}
+
+GFW::Points::Points::Points(const SDL_Rect& rect)
+{
+	Points p = GetRectBounds(rect);
+	v = p.v;
+	midp = p.midp;
+}
+
+GFW::Points::Points::Points(const Vector2D& vec)
+{
+	v.push_back({ vec.x, vec.y});
+	v.push_back({ vec.x + 1, vec.y });
+	v.push_back({ vec.x + 1, vec.y + 1 });
+	v.push_back({ vec.x, vec.y + 1});
+	midp = v[0];
+}
+
+GFW::Points::Points& GFW::Points::Points::operator=(const SDL_Rect& rect)
+{
+	Points p = GetRectBounds(rect);
+	v = p.v;
+	midp = p.midp;
+	return *this;
+}
+
+GFW::Points::Points& GFW::Points::Points::operator=(const Vector2D& vec)
+{
+	Points p = { vec };
+	v = p.v;
+	midp = p.midp;
+	return *this;
+}
+
+void GFW::Points::Points::Draw(SDL_Renderer* renderer)
+{
+	if (filled) {
+		DrawFilled(renderer, v);
+		return;
+	}
+
+	//reused between calls so drawing many outlines doesn't allocate for each
+	static vector<SDL_Point> points;
+
+	points.clear();
+	for (const Vector2D& p : v) {
+		points.push_back({ p.x, p.y });
+	}
+
+	if (points.empty()) {
+		return;
+	}
+	//like SDL_Points, the outline is closed back to the first point
+	points.push_back(points[0]);
+
+	GFW_SetRenderDrawColor(renderer, color);
+	SDL_RenderDrawLines(renderer, points.data(), static_cast<int>(points.size()));
+}
+
+void GFW::Points::Points::DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera)
+{
+	if (camera.IsIdentity()) {
+		Draw(renderer);
+		return;
+	}
+
+	if (filled) {
+		//the camera keeps the winding order, so the triangles of the world vertices still apply
+		static vector<Vector2D> transformed;
+
+		transformed.clear();
+		for (const Vector2D& p : v) {
+			transformed.push_back(camera.WorldToScreen(p));
+		}
+		DrawFilled(renderer, transformed);
+		return;
+	}
+
+	//reused between calls like the circle spans
+	static vector<SDL_Point> points;
+
+	points.clear();
+	for (const Vector2D& p : v) {
+		Vector2D s = camera.WorldToScreen(p);
+		points.push_back({ s.x, s.y });
+	}
+
+	if (points.empty()) {
+		return;
+	}
+	points.push_back(points[0]);
+
+	GFW_SetRenderDrawColor(renderer, color);
+	SDL_RenderDrawLines(renderer, points.data(), static_cast<int>(points.size()));
+}
+
+bool GFW::Points::Points::Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera)
+{
+	static vector<SDL_Point> points;
+
+	points.clear();
+	for (const Vector2D& p : v) {
+		Vector2D s = camera.WorldToScreen(p);
+		points.push_back({ s.x, s.y });
+	}
+
+	if (filled) {
+		target.FillPolygon(points.data(), static_cast<int>(points.size()), color);
+	}
+	else if (!points.empty()) {
+		//like Draw, the outline is closed
+		points.push_back(points[0]);
+		target.DrawLines(points.data(), static_cast<int>(points.size()), color);
+	}
+	return true;
+}
+
+const vector<int>& GFW::Points::Points::Triangulate()
+{
+	//v is public, so the cache is checked against a copy of the vertices it was built from
+	if (triangulated.size() != v.size() || !equal(v.begin(), v.end(), triangulated.begin(),
+		[](const Vector2D& a, const Vector2D& b) { return a.x == b.x && a.y == b.y; })) {
+		GFW::Points::Triangulate(v, triangles);
+		triangulated = v;
+	}
+	return triangles;
+}
+
+void GFW::Points::Points::DrawFilled(SDL_Renderer* renderer, const vector<Vector2D>& vertices)
+{
+	//reused between calls so filling doesn't allocate once it has grown to the largest polygon
+	static vector<SDL_Rect> spans;
+
+	TriangleSpans(spans, vertices, Triangulate());
+
+	if (spans.empty()) {
+		return;
+	}
+
+	GFW_SetRenderDrawColor(renderer, color);
+	SDL_RenderFillRects(renderer, spans.data(), static_cast<int>(spans.size()));
+}
+
+//twice the signed area of the triangle abc, positive when it turns the same way as a polygon with positive area
+static Sint64 Cross(const GFW::Vector2D& a, const GFW::Vector2D& b, const GFW::Vector2D& c)
+{
+	return static_cast<Sint64>(b.x - a.x) * (c.y - a.y) - static_cast<Sint64>(b.y - a.y) * (c.x - a.x);
+}
+
+void GFW::Points::Triangulate(const vector<Vector2D>& vertices, vector<int>& triangles)
+{
+	triangles.clear();
+
+	int n = static_cast<int>(vertices.size());
+	if (n > 1 && vertices[0].x == vertices[n - 1].x && vertices[0].y == vertices[n - 1].y) {
+		n--;
+	}
+	if (n < 3) {
+		return;
+	}
+
+	Sint64 area = 0;
+	for (int i = 0; i < n; i++) {
+		const Vector2D& a = vertices[i];
+		const Vector2D& b = vertices[(i + 1) % n];
+		area += static_cast<Sint64>(a.x) * b.y - static_cast<Sint64>(b.x) * a.y;
+	}
+	int winding = area >= 0 ? 1 : -1;
+
+	vector<int> remaining(n);
+	iota(remaining.begin(), remaining.end(), 0);
+
+	//each pass over the remaining vertices clips an ear, a vertex whose triangle is convex and holds no other vertex
+	int misses = 0;
+	for (int i = 0; remaining.size() > 3; ) {
+		int count = static_cast<int>(remaining.size());
+		int prev = remaining[(i + count - 1) % count], cur = remaining[i % count], next = remaining[(i + 1) % count];
+		const Vector2D& a = vertices[prev];
+		const Vector2D& b = vertices[cur];
+		const Vector2D& c = vertices[next];
+		bool ear = Cross(a, b, c) * winding > 0;
+
+		for (int j = 0; ear && j < count; j++) {
+			int k = remaining[j];
+			if (k == prev || k == cur || k == next) {
+				continue;
+			}
+			const Vector2D& p = vertices[k];
+			ear = !(Cross(a, b, p) * winding >= 0 && Cross(b, c, p) * winding >= 0 && Cross(c, a, p) * winding >= 0);
+		}
+
+		//a self-intersecting or degenerate outline can run out of ears, then the vertex is clipped anyway
+		if (ear || misses >= count) {
+			triangles.push_back(prev);
+			triangles.push_back(cur);
+			triangles.push_back(next);
+			remaining.erase(remaining.begin() + i % count);
+			misses = 0;
+			i = i % count;
+		}
+		else {
+			misses++;
+			i = (i + 1) % count;
+		}
+	}
+
+	triangles.push_back(remaining[0]);
+	triangles.push_back(remaining[1]);
+	triangles.push_back(remaining[2]);
+}
+
+void GFW::Points::TriangleSpans(vector<SDL_Rect>& spans, const vector<Vector2D>& vertices, const vector<int>& triangles)
+{
+	spans.clear();
+
+	for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+		const Vector2D* corner[3] = { &vertices[triangles[t]], &vertices[triangles[t + 1]], &vertices[triangles[t + 2]] };
+
+		//sorted from top to bottom
+		if (corner[1]->y < corner[0]->y) swap(corner[0], corner[1]);
+		if (corner[2]->y < corner[1]->y) swap(corner[1], corner[2]);
+		if (corner[1]->y < corner[0]->y) swap(corner[0], corner[1]);
+
+		const Vector2D& top = *corner[0];
+		const Vector2D& mid = *corner[1];
+		const Vector2D& bottom = *corner[2];
+
+		if (top.y == bottom.y) {
+			continue;
+		}
+
+		//rows whose centers lie in [top, bottom)
+		for (int y = top.y; y < bottom.y; y++) {
+			double cy = y + 0.5;
+
+			//an edge is always evaluated from its upper end, so a shared edge gives the same x in both triangles
+			auto edgeX = [cy](const Vector2D& from, const Vector2D& to) {
+				return from.x + (cy - from.y) * (to.x - from.x) / (to.y - from.y);
+			};
+
+			double longX = edgeX(top, bottom);
+			double shortX = cy < mid.y ? edgeX(top, mid) : edgeX(mid, bottom);
+			double left = min(longX, shortX), right = max(longX, shortX);
+
+			//pixels whose centers lie in [left, right)
+			int from = static_cast<int>(ceil(left - 0.5)), to = static_cast<int>(ceil(right - 0.5));
+
+			if (to > from) {
+				spans.push_back({ from, y, to - from, 1 });
+			}
+		}
+	}
+
+	sort(spans.begin(), spans.end(), [](const SDL_Rect& a, const SDL_Rect& b) { return a.y != b.y ? a.y < b.y : a.x < b.x; });
+
+	size_t merged = 0;
+	for (size_t i = 0; i < spans.size(); i++) {
+		if (merged > 0 && spans[merged - 1].y == spans[i].y && spans[merged - 1].x + spans[merged - 1].w == spans[i].x) {
+			spans[merged - 1].w += spans[i].w;
+		}
+		else {
+			spans[merged++] = spans[i];
+		}
+	}
+	spans.resize(merged);
+}
+ 
+GFW::Vector2D GFW::Points::RotatePoint(Vector2D origin, Vector2D orginal_point, double angle)
+{
+	Vector2D newpoint;
+
+#ifdef GFW_FIXED_POINT
+	int step = FixedAngleSteps(angle);
+	Sint64 c = FixedCos(step).raw, s = FixedSin(step).raw;
+	Sint64 dx = orginal_point.x - origin.x, dy = orginal_point.y - origin.y;
+	Sint64 half = Fixed::One >> 1;
+
+	newpoint.x = static_cast<int>((c * dx - s * dy + half) >> Fixed::FractionBits) + origin.x;
+	newpoint.y = static_cast<int>((s * dx + c * dy + half) >> Fixed::FractionBits) + origin.y;
+#else
+	angle = (angle) * (M_PI / 180);
+	newpoint.x = round(cos(angle) * (orginal_point.x - origin.x) - sin(angle) * (orginal_point.y - origin.y) + origin.x);
+	newpoint.y = round(sin(angle) * (orginal_point.x - origin.x) + cos(angle) * (orginal_point.y - origin.y) + origin.y);
+#endif
+
+	return newpoint;
+}
+
+GFW::Points::Points GFW::Points::RotatePoints(Points p, double angle)
+{
+	Points newpoints;
+	newpoints.midp = p.midp;
+
+	for (Vector2D point : p.v) {
+		newpoints.v.push_back(RotatePoint(p.midp, point, angle));
+	}
+
+	return newpoints;
+}
+
+void GFW::Image::Image::Draw(SDL_Renderer* renderer)
+{
+	SDL_RenderCopyEx(renderer, texture, srcRect.w > 0 ? &srcRect : NULL, &rect, angle, NULL, SDL_FLIP_NONE);
+}
+
+//the rect covering the given vertices with edges inclusive, false if there are none
+static bool VertexRect(const GFW::Vector2D* v, int count, SDL_Rect& rect)
+{
+	if (count <= 0) {
+		return false;
+	}
+
+	int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+	for (int i = 0; i < count; i++) {
+		minX = min(minX, v[i].x);
+		minY = min(minY, v[i].y);
+		maxX = max(maxX, v[i].x);
+		maxY = max(maxY, v[i].y);
+	}
+
+	rect = { minX, minY, maxX - minX + 1, maxY - minY + 1 };
+	return true;
+}
+
+//the screen rect and angle of a rect rotated around its center, as seen through the camera
+static SDL_Rect CameraRect(const GFW::Render::Camera& camera, const SDL_Rect& rect, double& angle)
+{
+	double sx, sy;
+	camera.WorldToScreen(rect.x + rect.w / 2.0, rect.y + rect.h / 2.0, sx, sy);
+
+	double w = rect.w * camera.zoom, h = rect.h * camera.zoom;
+	angle -= camera.rotation;
+
+	return { static_cast<int>(lround(sx - w / 2)), static_cast<int>(lround(sy - h / 2)), static_cast<int>(lround(w)), static_cast<int>(lround(h)) };
+}
+
+void GFW::Image::Image::DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera)
+{
+	if (camera.IsIdentity()) {
+		Draw(renderer);
+		return;
+	}
+
+	double a = angle;
+	SDL_Rect dst = CameraRect(camera, rect, a);
+	SDL_RenderCopyEx(renderer, texture, srcRect.w > 0 ? &srcRect : NULL, &dst, a, NULL, SDL_FLIP_NONE);
+}
+
+bool GFW::Image::Image::Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera)
+{
+	double a = angle;
+	SDL_Rect dst = camera.IsIdentity() ? rect : CameraRect(camera, rect, a);
+	return target.CopyEx(texture, srcRect.w > 0 ? &srcRect : NULL, dst, a);
+}
+
+GFW::Image::AtlasBuilder::~AtlasBuilder()
+{
+	for (Entry& entry : entries) {
+		SDL_FreeSurface(entry.surface);
+	}
+}
+
+int GFW::Image::AtlasBuilder::Add(string img_path)
+{
+	SDL_Surface* temp = IMG_Load(img_path.c_str());
+
+	if (temp == nullptr) {
+		return -1;
+	}
+
+	int handle = Add(temp);
+	SDL_FreeSurface(temp);
+	return handle;
+}
+
+int GFW::Image::AtlasBuilder::Add(SDL_Surface* surface)
+{
+	SDL_Surface* copy = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+
+	if (copy == nullptr) {
+		return -1;
+	}
+
+	//copied as is, including alpha, instead of being blended onto the page
+	SDL_SetSurfaceBlendMode(copy, SDL_BLENDMODE_NONE);
+	entries.push_back({ copy, -1, { 0, 0, copy->w, copy->h } });
+	return static_cast<int>(entries.size()) - 1;
+}
+
+namespace {
+	//a skyline bottom-left packer: the page's used area is tracked as a list of horizontal segments
+	struct Skyline {
+		struct Node { int x, y, w; };
+
+		int w, h;
+		vector<Node> nodes;
+
+		Skyline(int w, int h) : w(w), h(h) { nodes.push_back({ 0, 0, w }); }
+
+		bool Insert(int rw, int rh, SDL_Rect& out)
+		{
+			int best = -1, bestY = INT_MAX, bestTop = INT_MAX, bestW = INT_MAX;
+
+			for (int i = 0; i < static_cast<int>(nodes.size()); i++) {
+				int x = nodes[i].x;
+				if (x + rw > w) {
+					break;
+				}
+
+				//the rect rests on the highest segment it spans
+				int y = 0, remaining = rw;
+				for (int j = i; remaining > 0; j++) {
+					y = max(y, nodes[j].y);
+					remaining -= nodes[j].w;
+				}
+				if (y + rh > h) {
+					continue;
+				}
+
+				if (y + rh < bestTop || (y + rh == bestTop && nodes[i].w < bestW)) {
+					best = i;
+					bestY = y;
+					bestTop = y + rh;
+					bestW = nodes[i].w;
+				}
+			}
+
+			if (best == -1) {
+				return false;
+			}
+
+			out = { nodes[best].x, bestY, rw, rh };
+
+			nodes.insert(nodes.begin() + best, { out.x, bestY + rh, rw });
+
+			//shrink or remove the segments now covered by the new one
+			for (size_t i = best + 1; i < nodes.size();) {
+				int covered = nodes[i - 1].x + nodes[i - 1].w - nodes[i].x;
+				if (covered <= 0) {
+					break;
+				}
+				nodes[i].x += covered;
+				nodes[i].w -= covered;
+				if (nodes[i].w <= 0) {
+					nodes.erase(nodes.begin() + i);
+				}
+				else {
+					break;
+				}
+			}
+
+			for (size_t i = 0; i + 1 < nodes.size();) {
+				if (nodes[i].y == nodes[i + 1].y) {
+					nodes[i].w += nodes[i + 1].w;
+					nodes.erase(nodes.begin() + i + 1);
+				}
+				else {
+					i++;
+				}
+			}
+
+			return true;
+		}
+	};
+}
+
+void GFW::Image::AtlasBuilder::Build(SDL_Renderer* renderer)
+{
+	Destroy();
+
+	//tallest first packs a skyline much more tightly
+	vector<int> order(entries.size());
+	iota(order.begin(), order.end(), 0);
+	sort(order.begin(), order.end(), [this](int a, int b) { return entries[a].surface->h > entries[b].surface->h; });
+
+	vector<Skyline> skylines;
+	vector<pair<int, int>> pageSizes;
+
+	for (int index : order) {
+		Entry& entry = entries[index];
+		int w = entry.surface->w + padding * 2;
+		int h = entry.surface->h + padding * 2;
+		SDL_Rect placed;
+
+		entry.page = -1;
+		for (size_t page = 0; page < skylines.size(); page++) {
+			if (skylines[page].Insert(w, h, placed)) {
+				entry.page = static_cast<int>(page);
+				break;
+			}
+		}
+
+		if (entry.page == -1) {
+			skylines.push_back(Skyline(max(pageSize, w), max(pageSize, h)));
+			pageSizes.push_back({ 0, 0 });
+			skylines.back().Insert(w, h, placed);
+			entry.page = static_cast<int>(skylines.size()) - 1;
+		}
+
+		entry.rect = { placed.x + padding, placed.y + padding, entry.surface->w, entry.surface->h };
+		pageSizes[entry.page].first = max(pageSizes[entry.page].first, placed.x + w);
+		pageSizes[entry.page].second = max(pageSizes[entry.page].second, placed.y + h);
+	}
+
+	for (size_t page = 0; page < skylines.size(); page++) {
+		//pages are only as large as the area actually used
+		SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, pageSizes[page].first, pageSizes[page].second, 32, SDL_PIXELFORMAT_ARGB8888);
+		SDL_FillRect(surface, NULL, 0);
+
+		for (Entry& entry : entries) {
+			if (entry.page == static_cast<int>(page)) {
+				SDL_BlitSurface(entry.surface, NULL, surface, &entry.rect);
+			}
+		}
+
+		//premultiplied pages also keep filtering from pulling in the color of the transparent padding
+		SDL_Texture* texture = CreateTexture(surface, renderer);
+		SDL_FreeSurface(surface);
+		pages.push_back(texture);
+	}
+}
+
+GFW::Image::Image GFW::Image::AtlasBuilder::CreateImg(int handle)
+{
+	Image img;
+	Entry& entry = entries[handle];
+
+	img.texture = pages[entry.page];
+	img.srcRect = entry.rect;
+	img.rect.w = entry.rect.w;
+	img.rect.h = entry.rect.h;
+
+	return img;
+}
+
+void GFW::Image::AtlasBuilder::Destroy()
+{
+	for (SDL_Texture* page : pages) {
+		Render::SoftwareRenderer::ReleaseTexture(page);
+		SDL_DestroyTexture(page);
+	}
+	pages.clear();
+}
+
+bool GFW::Image::SpriteSheet::Load(string img_path, SDL_Renderer* renderer)
+{
+	textureRef = Image::textureCache.Acquire(img_path, renderer);
+	texture = textureRef.Get();
+
+	return texture != nullptr;
+}
+
+int GFW::Image::SpriteSheet::AddGrid(int cellW, int cellH, int first, int count, Uint32 duration, bool loop)
+{
+	int width = 0;
+	SDL_QueryTexture(texture, nullptr, nullptr, &width, nullptr);
+	int columns = max(1, width / max(cellW, 1));
+
+	vector<Frame> grid;
+	for (int i = first; i < first + count; i++) {
+		grid.push_back({ { (i % columns) * cellW, (i / columns) * cellH, cellW, cellH }, duration });
+	}
+
+	return AddAnimation(grid, loop);
+}
+
+int GFW::Image::SpriteSheet::AddAnimation(const vector<Frame>& animationFrames, bool loop)
+{
+	if (animationFrames.empty()) {
+		cerr << "error: an animation needs at least one frame" << endl;
+		return -1;
+	}
+
+	Animation animation = { static_cast<int>(frames.size()), static_cast<int>(animationFrames.size()), 0, loop };
+	for (const Frame& frame : animationFrames) {
+		animation.length += frame.duration;
+	}
+
+	frames.insert(frames.end(), animationFrames.begin(), animationFrames.end());
+	animations.push_back(animation);
+
+	return static_cast<int>(animations.size()) - 1;
+}
+
+GFW::Image::Image GFW::Image::SpriteSheet::CreateImg(int animation)
+{
+	Image img;
+	const Frame& frame = frames[animations[animation].first];
+
+	img.texture = texture;
+	img.textureRef = textureRef;
+	img.srcRect = frame.src;
+	img.rect.w = frame.src.w;
+	img.rect.h = frame.src.h;
+
+	return img;
+}
+
+void GFW::Image::SpriteSheet::Seek(Player& player)
+{
+	const Animation& animation = animations[player.animation];
+
+	if (player.time >= animation.length) {
+		if (animation.loop && animation.length > 0) {
+			player.time %= animation.length;
+			player.frame = 0;
+			player.frameEnd = frames[animation.first].duration;
+		}
+		else {
+			player.frame = animation.count - 1;
+			player.finished = true;
+		}
+	}
+
+	while (!player.finished && player.time >= player.frameEnd && player.frame + 1 < animation.count) {
+		player.frame++;
+		player.frameEnd += frames[animation.first + player.frame].duration;
+	}
+
+	player.img->srcRect = frames[animation.first + player.frame].src;
+}
+
+void GFW::Image::SpriteSheet::Play(Image& img, int animation, bool restart)
+{
+	if (animation < 0 || animation >= static_cast<int>(animations.size())) {
+		return;
+	}
+
+	auto found = playerIndex.find(&img);
+	if (found == playerIndex.end()) {
+		found = playerIndex.emplace(&img, players.size()).first;
+		players.push_back({ &img, -1, 0, 0, 0, false });
+	}
+
+	Player& player = players[found->second];
+	if (player.animation == animation && !restart) {
+		return;
+	}
+
+	player.animation = animation;
+	player.frame = 0;
+	player.time = 0;
+	player.frameEnd = frames[animations[animation].first].duration;
+	player.finished = false;
+
+	img.texture = texture;
+	img.textureRef = textureRef;
+	Seek(player);
+}
+
+void GFW::Image::SpriteSheet::Stop(Image& img)
+{
+	auto found = playerIndex.find(&img);
+	if (found == playerIndex.end()) {
+		return;
+	}
+
+	size_t index = found->second;
+	playerIndex.erase(found);
+
+	if (index + 1 < players.size()) {
+		players[index] = players.back();
+		playerIndex[players[index].img] = index;
+	}
+	players.pop_back();
+}
+
+bool GFW::Image::SpriteSheet::IsPlaying(Image& img)
+{
+	auto found = playerIndex.find(&img);
+	return found != playerIndex.end() && !players[found->second].finished;
+}
+
+void GFW::Image::SpriteSheet::Advance(Uint32 ms)
+{
+	for (Player& player : players) {
+		if (player.finished) {
+			continue;
+		}
+
+		player.time += ms;
+
+		//most updates don't reach the end of the current frame, so nothing else is touched
+		if (player.time >= player.frameEnd) {
+			Seek(player);
+		}
+	}
+}
+
+void GFW::Image::SpriteSheet::Destroy()
+{
+	textureRef.Reset();
+	texture = nullptr;
+}
+
+void GFW::Text::FontManager::LoadFont(string fontPath, int fsize, string fontName, int style)
+{
+	if (fontPath == "") {
+		fontName = fontPath.substr(0, fontPath.find_last_of('.'));
+	}
+
+	string path = DefaultPath + fontPath;
+
+	TTF_Font* font = TTF_OpenFont(path.c_str(), fsize);
+
+	TTF_SetFontStyle(font, style);
+
+	regF[fontName] = font;
+}
+
+void GFW::Text::Text::DoUpdate(SDL_Renderer* renderer)
+{
+	if (texture != nullptr) {
+		Render::SoftwareRenderer::ReleaseTexture(texture);
+		SDL_DestroyTexture(texture);
+	}
+
+	SDL_Surface* surface;
+
+	surface = TTF_RenderText_Blended(font, msg.c_str(), color);
+
+	texture = SDL_CreateTextureFromSurface(renderer, surface);
+	Render::SoftwareRenderer::CaptureTexture(renderer, texture, surface);
+
+	SDL_FreeSurface(surface);
+
+	SDL_QueryTexture(texture, NULL, NULL, &size.first, &size.second);
+}
+
+void GFW::Text::Text::Draw(SDL_Renderer* renderer)
+{
+	if (texture != nullptr) {
+		SDL_Rect rect = { pos.x, pos.y, size.first, size.second };
+		SDL_RenderCopyEx(renderer, texture, NULL, &rect, angle, NULL, SDL_FLIP_NONE);
+	}
+}
+
+void GFW::Text::Text::DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera)
+{
+	if (camera.IsIdentity()) {
+		Draw(renderer);
+		return;
+	}
+
+	if (texture != nullptr) {
+		double a = angle;
+		SDL_Rect dst = CameraRect(camera, { pos.x, pos.y, size.first, size.second }, a);
+		SDL_RenderCopyEx(renderer, texture, NULL, &dst, a, NULL, SDL_FLIP_NONE);
+	}
+}
+
+bool GFW::Text::Text::Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera)
+{
+	if (texture == nullptr) {
+		return true;
+	}
+
+	double a = angle;
+	SDL_Rect rect = { pos.x, pos.y, size.first, size.second };
+	SDL_Rect dst = camera.IsIdentity() ? rect : CameraRect(camera, rect, a);
+	return target.CopyEx(texture, NULL, dst, a);
+}
+
+GFW::Points::Points GFW::Text::Text::GetBounds() {
+	pair<int, int> size = GetTextSize();
+	return { { pos.x, pos.y, size.first, size.second } };
+};
+
+GFW::Collision::AnyShape GFW::Text::Text::GetShape() {
+	return Collision::AABB(pos.x, pos.y, size.first, size.second);
+}
+
+GFW::Collision::AnyShape GFW::Image::Image::GetShape() {
+	return Collision::ConvexPoly(BoundingBox);
+}
+
+GFW::Collision::AnyShape GFW::Circle::Circle::GetShape() {
+	return Collision::CircleShape(pos, r);
+}
+
+GFW::Collision::AnyShape GFW::Points::Polygon::GetShape() {
+	return Collision::AnyShape();
+}
+
+bool GFW::Points::Polygon::detectCollision(Points points) {
+	Collision::AnyShape shape = GetShape();
+
+	if (shape.kind == Collision::SHAPE_NONE) {
+		return Collision::detectCollision(GetBounds(), points);
+	}
+	return Collision::Intersects(shape, Collision::ConvexPoly(points));
+}
+
+bool GFW::Points::Polygon::detectCollision(Polygon& poly) {
+	Collision::AnyShape a = GetShape();
+	Collision::AnyShape b = poly.GetShape();
+
+	//Polygons which only provide GetBounds() fall back to copying their bounds
+	if (a.kind == Collision::SHAPE_NONE && b.kind == Collision::SHAPE_NONE) {
+		return Collision::detectCollision(GetBounds(), poly.GetBounds());
+	}
+	if (a.kind == Collision::SHAPE_NONE) {
+		Points bounds = GetBounds();
+		return Collision::Intersects(Collision::AnyShape(Collision::ConvexPoly(bounds)), b);
+	}
+	if (b.kind == Collision::SHAPE_NONE) {
+		Points bounds = poly.GetBounds();
+		return Collision::Intersects(a, Collision::AnyShape(Collision::ConvexPoly(bounds)));
+	}
+	return Collision::Intersects(a, b);
+}
+
+GFW::FVector2D& GFW::FVector2D::operator=(const Vector2D& vec) {
+	x = static_cast<Scalar>(vec.x);
+	y = static_cast<Scalar>(vec.y);
+	return *this;
+};
+
+//draws in world coordinates through the camera, skipping the transform when there is none
+static void DrawThrough(GFW::Drawable& drawable, SDL_Renderer* renderer, const GFW::Render::Camera* camera)
+{
+	if (camera != nullptr && !camera->IsIdentity()) {
+		drawable.DrawTransformed(renderer, *camera);
+	}
+	else {
+		drawable.Draw(renderer);
+	}
+}
+
+void GFW::Inst::EnableSoftwareRaster(bool enable, int threads) {
+	if (enable && softRaster == nullptr) {
+		softRaster = new Render::SoftwareRenderer(screenW, screenH, threads);
+		softRaster->Attach(renderer);
+	}
+	else if (!enable && softRaster != nullptr) {
+		softRaster->Destroy();
+		delete softRaster;
+		softRaster = nullptr;
+	}
+}
+
+void GFW::Inst::EnableDirtyRects(bool enable) {
+	if (enable && frameTarget == nullptr) {
+		if (!SDL_RenderTargetSupported(renderer)) {
+			cout << "dirty rects need render target support" << endl;
+			return;
+		}
+
+		frameTarget = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, screenW, screenH);
+
+		if (!frameTarget) {
+			gerror_print();
+			return;
+		}
+		//the copy onto the backbuffer replaces it, blending would show whatever the backbuffer held through a translucent background
+		SDL_SetTextureBlendMode(frameTarget, SDL_BLENDMODE_NONE);
+	}
+	else if (!enable && frameTarget != nullptr) {
+		SDL_DestroyTexture(frameTarget);
+		frameTarget = nullptr;
+	}
+
+	damageTracker.DamageAll();
+	dirtyRects = enable;
+}
+
+void GFW::Inst::Draw(Drawable& drawable) {
+	SDL_Rect rect;
+	cullStats.submitted++;
+
+	if (drawable.GetDrawRect(rect) && !camera.IsVisible(rect)) {
+		cullStats.culled++;
+		return;
+	}
+
+	if (softRaster != nullptr) {
+		softRaster->Submit(drawable, camera);
+	}
+	else if (dirtyRects) {
+		damageTracker.Record(drawable);
+	}
+	else if (queueDraws) {
+		renderQueue.Push(drawable, drawLayer);
+	}
+	else {
+		DrawThrough(drawable, renderer, &camera);
+	}
+}
+
+void GFW::Inst::Draw(DrawList& list) {
+	if (softRaster != nullptr) {
+		list.Rasterize(*softRaster, camera);
+		return;
+	}
+	//the frame is rebuilt in frameTarget by pres, anything drawn straight to the backbuffer would be covered
+	if (dirtyRects) {
+		list.Record(damageTracker);
+		return;
+	}
+
+	renderQueue.Flush(renderer, &camera);
+	list.Draw(renderer, &camera);
+}
+
+void GFW::Inst::DrawVisible(Render::SpatialGrid& grid) {
+	//reused between frames so the query doesn't allocate
+	static vector<Drawable*> visible;
+
+	grid.Query(camera.GetViewBounds(), visible);
+
+	for (Drawable* drawable : visible) {
+		Draw(*drawable);
+	}
+}
+
+void GFW::Inst::DrawBounds(const Points::Points& bounds) {
+	SDL_Rect rect;
+	cullStats.submitted++;
+
+	if (VertexRect(bounds.v.data(), static_cast<int>(bounds.v.size()), rect) && !camera.IsVisible(rect)) {
+		cullStats.culled++;
+		return;
+	}
+
+	if (softRaster != nullptr) {
+		//the Drawable interface isn't const, but drawing Points only writes their (mutable) triangulation cache
+		softRaster->Submit(const_cast<Points::Points&>(bounds), camera);
+	}
+	else if (batchBounds) {
+		debugBatch.Add(bounds, &camera);
+	}
+	else if (dirtyRects) {
+		damageTracker.Record(bounds);
+	}
+	else if (queueDraws) {
+		renderQueue.Push(bounds, drawLayer);
+	}
+	else {
+		const_cast<Points::Points&>(bounds).DrawTransformed(renderer, camera);
+	}
+}
+
+void GFW::Inst::DrawBounds(Points::Polygon& poly, SDL_Color color) {
+	//the batch only needs the vertices, which rect shapes and shapes referring to their Points give without a copy
+	if (batchBounds && softRaster == nullptr) {
+		Collision::AnyShape shape = poly.GetShape();
+		const Vector2D* v = nullptr;
+		int count = 0;
+		Vector2D corners[4];
+
+		if (shape.kind == Collision::SHAPE_CONVEX_POLY) {
+			v = shape.poly.v;
+			count = shape.poly.count;
+		}
+		else if (shape.kind == Collision::SHAPE_AABB) {
+			//the same corners as Points::GetRectBounds
+			const Collision::AABB& box = shape.aabb;
+			corners[0] = { box.x, box.y };
+			corners[1] = { box.x + box.w, box.y };
+			corners[2] = { box.x + box.w, box.y + box.h };
+			corners[3] = { box.x, box.y + box.h };
+			v = corners;
+			count = 4;
+		}
+
+		if (v != nullptr) {
+			SDL_Rect rect;
+			cullStats.submitted++;
+
+			if (VertexRect(v, count, rect) && !camera.IsVisible(rect)) {
+				cullStats.culled++;
+				return;
+			}
+			debugBatch.Add(v, count, color, &camera);
+			return;
+		}
+	}
+
+	Points::Points points = poly.GetBounds();
+	points.color = color;
+	DrawBounds(points);
+}
+
+
+GFW::Points::SDL_Points::SDL_Points(const vector<Vector2D>& v)
+{
+	for (Vector2D p : v) {
+		points.push_back({ p.x, p.y });
+	}
+	points.push_back(points[0]);
+}
+
+GFW::Points::SDL_Points& GFW::Points::SDL_Points::operator=(const vector<Vector2D>& v)
+{
+	points.clear();
+	for (Vector2D p : v) {
+		points.push_back({p.x, p.y});
+	}
+
+	points.push_back(points[0]);
+
+	return *this;
+}
+
+void GFW::Circle::CircleSpans(vector<SDL_Rect>& spans, Vector2D center, int r, bool filled)
+{
+	if (r < 0) {
+		return;
+	}
+
+	//half widths of each row (covering x * x + y * y <= r * r), walked inwards from the widest row so every step is an integer compare
+	int r2 = r * r;
+	int hw = r;
+	int nextHw = r;
+
+	for (int y = 0; y <= r; y++) {
+		hw = nextHw;
+		nextHw = hw;
+		while (nextHw >= 0 && nextHw * nextHw + (y + 1) * (y + 1) > r2) {
+			nextHw--;
+		}
+
+		//an outline pixel has a neighbour outside the circle, either beside it or in the next row out
+		int inner = filled ? -1 : min(nextHw, hw - 1);
+
+		for (int row : { center.y - y, center.y + y }) {
+			if (inner < 0) {
+				spans.push_back({ center.x - hw, row, 2 * hw + 1, 1 });
+			}
+			else {
+				spans.push_back({ center.x - hw, row, hw - inner, 1 });
+				spans.push_back({ center.x + inner + 1, row, hw - inner, 1 });
+			}
+
+			if (y == 0) {
+				break;
+			}
+		}
+	}
+}
+
+SDL_Texture* GFW::Circle::SpriteCache::Acquire(SDL_Renderer* renderer, int r, SDL_Color color, bool filled)
+{
+	Key key = { renderer, r, static_cast<Uint32>(color.r << 24 | color.g << 16 | color.b << 8 | color.a), filled };
+
+	auto found = entries.find(key);
+	if (found != entries.end()) {
+		hits++;
+		lru.splice(lru.begin(), lru, found->second);
+		return found->second->texture;
+	}
+	misses++;
+
+	int size = 2 * r + 1;
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_ARGB8888);
+
+	if (surface == nullptr) {
+		return nullptr;
+	}
+
+	vector<SDL_Rect> spans;
+	CircleSpans(spans, { r, r }, r, filled);
+	SDL_FillRects(surface, spans.data(), static_cast<int>(spans.size()), SDL_MapRGBA(surface->format, color.r, color.g, color.b, color.a));
+
+	SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+	SDL_FreeSurface(surface);
+
+	if (texture == nullptr) {
+		return nullptr;
+	}
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+	lru.push_front({ key, texture, static_cast<size_t>(size) * size * 4 });
+	entries[key] = lru.begin();
+	usage += lru.front().bytes;
+
+	Evict();
+
+	return texture;
+}
+
+void GFW::Circle::SpriteCache::Evict()
+{
+	//the most recently used texture is always kept, even if it alone is over budget
+	while (usage > budget && lru.size() > 1) {
+		Entry& entry = lru.back();
+		SDL_DestroyTexture(entry.texture);
+		usage -= entry.bytes;
+		entries.erase(entry.key);
+		lru.pop_back();
+	}
+}
+
+void GFW::Circle::SpriteCache::Clear()
+{
+	for (Entry& entry : lru) {
+		SDL_DestroyTexture(entry.texture);
+	}
+	lru.clear();
+	entries.clear();
+	usage = 0;
+}
+
+void GFW::Circle::Circle::Draw(SDL_Renderer* renderer) {
+	DrawAt(renderer, pos, r);
+}
+
+void GFW::Circle::Circle::DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera) {
+	DrawAt(renderer, camera.WorldToScreen(pos), static_cast<int>(lround(r * camera.zoom)));
+}
+
+bool GFW::Circle::Circle::Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera) {
+	static vector<SDL_Rect> spans;
+
+	spans.clear();
+	CircleSpans(spans, camera.WorldToScreen(pos), static_cast<int>(lround(r * camera.zoom)), filled);
+
+	target.FillRects(spans.data(), static_cast<int>(spans.size()), color);
+	return true;
+}
+
+void GFW::Circle::Circle::DrawAt(SDL_Renderer* renderer, Vector2D center, int radius) {
+	if (cached) {
+		SDL_Texture* texture = spriteCache.Acquire(renderer, radius, color, filled);
+
+		if (texture != nullptr) {
+			SDL_Rect dst = { center.x - radius, center.y - radius, 2 * radius + 1, 2 * radius + 1 };
+			SDL_RenderCopy(renderer, texture, NULL, &dst);
+			return;
+		}
+	}
+
+	//reused between calls so drawing doesn't allocate once it has grown to the largest circle
+	static vector<SDL_Rect> spans;
+
+	spans.clear();
+	CircleSpans(spans, center, radius, filled);
+
+	GFW_SetRenderDrawColor(renderer, color);
+	SDL_RenderFillRects(renderer, spans.data(), static_cast<int>(spans.size()));
+}
+
+void GFW::Circle::Circle::DoUpdate(SDL_Renderer* renderer)
+{
+	BoundingBox.midp = pos;
+	BoundingBox.v.clear();
+
+#ifdef GFW_FIXED_POINT
+	//same spacing as below (about half a pixel along the circumference), but taken from the trig table
+	int inc = max(1, min(GFW_FIXED_TRIG_STEPS / 4, GFW_FIXED_TRIG_STEPS / (4 * 314 * max(r, 1) / 100)));
+
+	for (int step = 0; step < GFW_FIXED_TRIG_STEPS; step += inc) {
+		BoundingBox.v.push_back({ (Fixed(r) * FixedCos(step)).ToInt() + pos.x, (Fixed(r) * FixedSin(step)).ToInt() + pos.y });
+	}
+#else
+	double inc = min(0.5 / r, M_PI / 2);
+	double max = (M_PI * 2);
+
+	double angle = 0;
+
+	while (angle < max) {
+		BoundingBox.v.push_back({int( round( r * cos(angle) ) + pos.x), int(round(r * sin(angle)) + pos.y) });
+		angle += inc;
+	}
+#endif
+	BoundingBox.color = color;
+}
+
+void GFW::DrawList::Draw(SDL_Renderer* renderer, const Render::Camera* camera)
+{
+	if (camera != nullptr && !camera->IsIdentity()) {
+		for (Image::Image* img : images) {
+			img->Image::Image::DrawTransformed(renderer, *camera);
+		}
+		for (Text::Text* txt : texts) {
+			txt->Text::Text::DrawTransformed(renderer, *camera);
+		}
+		for (Circle::Circle* circle : circles) {
+			circle->Circle::Circle::DrawTransformed(renderer, *camera);
+		}
+		return;
+	}
+
+	//qualified calls are bound at compile time, so none of these loops go through the vtable
+	for (Image::Image* img : images) {
+		img->Image::Image::Draw(renderer);
+	}
+	for (Text::Text* txt : texts) {
+		txt->Text::Text::Draw(renderer);
+	}
+	for (Circle::Circle* circle : circles) {
+		circle->Circle::Circle::Draw(renderer);
+	}
+}
+
+void GFW::DrawList::Record(Render::DamageTracker& tracker)
+{
+	for (Image::Image* img : images) {
+		tracker.Record(*img);
+	}
+	for (Text::Text* txt : texts) {
+		tracker.Record(*txt);
+	}
+	for (Circle::Circle* circle : circles) {
+		tracker.Record(*circle);
+	}
+}
+
+void GFW::DrawList::Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera)
+{
+	for (Image::Image* img : images) {
+		img->Image::Image::Rasterize(target, camera);
+	}
+	for (Text::Text* txt : texts) {
+		txt->Text::Text::Rasterize(target, camera);
+	}
+	for (Circle::Circle* circle : circles) {
+		circle->Circle::Circle::Rasterize(target, camera);
+	}
+}
+
+template<typename T>
+T& GFW::Render::SnapshotPool::Slots<T>::Copy(const T& from)
+{
+	if (used == items.size()) {
+		items.push_back(from);
+	}
+	else {
+		items[used] = from;
+	}
+	return items[used++];
+}
+
+GFW::Drawable& GFW::Render::SnapshotPool::Take(Drawable& drawable)
+{
+	//only exact types are copied, slicing a derived class would lose whatever its Draw overrides
+	const type_info& type = typeid(drawable);
+
+	if (type == typeid(Image::Image)) {
+		return images.Copy(static_cast<Image::Image&>(drawable));
+	}
+	if (type == typeid(Text::Text)) {
+		return texts.Copy(static_cast<Text::Text&>(drawable));
+	}
+	if (type == typeid(Circle::Circle)) {
+		return circles.Copy(static_cast<Circle::Circle&>(drawable));
+	}
+	if (type == typeid(Points::Points)) {
+		return points.Copy(static_cast<Points::Points&>(drawable));
+	}
+	return drawable;
+}
+
+GFW::Points::Points& GFW::Render::SnapshotPool::Take(const Points::Points& bounds)
+{
+	return points.Copy(bounds);
+}
+
+void GFW::Render::SnapshotPool::Reset()
+{
+	images.used = 0;
+	texts.used = 0;
+	circles.used = 0;
+	points.used = 0;
+}
+
+void GFW::Render::RenderQueue::Push(Drawable& drawable, int layer)
+{
+	Drawable& copy = snapshots.Take(drawable);
+	Command command = { layer, false, sequence++, copy.GetRenderState(), &copy, { 0, 0, 0, 0 }, false, -1 };
+	command.bounded = copy.GetDrawRect(command.rect);
+
+	commands.push_back(command);
+	stats.commands++;
+}
+
+void GFW::Render::RenderQueue::Push(const Points::Points& bounds, int layer)
+{
+	Push(snapshots.Take(bounds), layer);
+}
+
+static bool SameBatchState(const GFW::Render::RenderState& a, const GFW::Render::RenderState& b)
+{
+	return a.texture == b.texture && a.blendMode == b.blendMode && SDL_memcmp(&a.color, &b.color, sizeof(SDL_Color)) == 0;
+}
+
+void GFW::Render::RenderQueue::Flush(SDL_Renderer* renderer, const Camera* camera)
+{
+	//how many batches a command may be moved past, which keeps batching linear in the number of commands
+	const size_t lookback = 32;
+
+	if (commands.empty()) {
+		return;
+	}
+
+	//resolved per layer when flushing, since every command of a layer has to agree even if the flag was toggled mid-frame
+	for (Command& command : commands) {
+		auto found = orderedLayers.find(command.layer);
+		command.ordered = found != orderedLayers.end() && found->second;
+	}
+
+	sort(commands.begin(), commands.end(), [](const Command& a, const Command& b) {
+		if (a.layer != b.layer) return a.layer < b.layer;
+		return a.sequence < b.sequence;
+	});
+
+	//each command joins the latest batch of its layer with the same state, as long as it only moves ahead of batches
+	//it doesn't overlap; otherwise it starts a new batch
+	batches.clear();
+	size_t layerStart = 0;
+
+	for (int i = 0; i < static_cast<int>(commands.size()); i++) {
+		Command& command = commands[i];
+		command.next = -1;
+
+		if (i > 0 && command.layer != commands[i - 1].layer) {
+			layerStart = batches.size();
+		}
+
+		size_t target = batches.size();
+		for (size_t b = batches.size(); b > layerStart && batches.size() - b < lookback; b--) {
+			const Batch& batch = batches[b - 1];
+
+			if (SameBatchState(batch.state, command.state)) {
+				target = b - 1;
+				break;
+			}
+			if (command.ordered || !command.bounded || !batch.bounded || SDL_HasIntersection(&batch.bounds, &command.rect)) {
+				break;
+			}
+		}
+
+		if (target == batches.size()) {
+			batches.push_back({ command.state, command.rect, command.bounded, i, i });
+			continue;
+		}
+
+		Batch& batch = batches[target];
+		commands[batch.last].next = i;
+		batch.last = i;
+
+		if (batch.bounded && command.bounded) {
+			SDL_UnionRect(&batch.bounds, &command.rect, &batch.bounds);
+		}
+		else {
+			batch.bounded = false;
+		}
+	}
+
+	const RenderState* previous = nullptr;
+	for (const Batch& batch : batches) {
+		if (previous != nullptr && !SameBatchState(batch.state, *previous)) {
+			stats.stateChanges++;
+		}
+		previous = &batch.state;
+
+		for (int i = batch.first; i != -1; i = commands[i].next) {
+			DrawThrough(*commands[i].drawable, renderer, camera);
+		}
+	}
+
+	commands.clear();
+	snapshots.Reset();
+	sequence = 0;
+	stats.flushes++;
+}
+
+vector<GFW::Render::StateTracker*> GFW::Render::StateTracker::attached;
+
+void GFW::Render::StateTracker::Attach(SDL_Renderer* r)
+{
+	Detach();
+	renderer = r;
+	Invalidate();
+	stats = StateTrackerStats();
+	attached.push_back(this);
+}
+
+void GFW::Render::StateTracker::Detach()
+{
+	if (renderer != nullptr) {
+		attached.erase(find(attached.begin(), attached.end(), this));
+		renderer = nullptr;
+	}
+}
+
+GFW::Render::StateTracker* GFW::Render::StateTracker::Find(SDL_Renderer* renderer)
+{
+	//there is almost always exactly one renderer, so a linear search is the cheapest lookup
+	for (StateTracker* tracker : attached) {
+		if (tracker->renderer == renderer) {
+			return tracker;
+		}
+	}
+	return nullptr;
+}
+
+void GFW::Render::StateTracker::Invalidate()
+{
+	colorKnown = blendKnown = targetKnown = clipKnown = false;
+}
+
+void GFW::Render::StateTracker::SetDrawColor(SDL_Color c)
+{
+	if (colorKnown && c.r == color.r && c.g == color.g && c.b == color.b && c.a == color.a) {
+		stats.skipped++;
+		return;
+	}
+	SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+	color = c;
+	colorKnown = true;
+	stats.issued++;
+}
+
+SDL_Color GFW::Render::StateTracker::GetDrawColor()
+{
+	if (!colorKnown) {
+		SDL_GetRenderDrawColor(renderer, &color.r, &color.g, &color.b, &color.a);
+		colorKnown = true;
+	}
+	return color;
+}
+
+void GFW::Render::StateTracker::SetBlendMode(SDL_BlendMode mode)
+{
+	if (blendKnown && mode == blendMode) {
+		stats.skipped++;
+		return;
+	}
+	SDL_SetRenderDrawBlendMode(renderer, mode);
+	blendMode = mode;
+	blendKnown = true;
+	stats.issued++;
+}
+
+void GFW::Render::StateTracker::SetTarget(SDL_Texture* t)
+{
+	if (targetKnown && t == target) {
+		stats.skipped++;
+		return;
+	}
+	SDL_SetRenderTarget(renderer, t);
+	target = t;
+	targetKnown = true;
+	//each target keeps its own clip rect
+	clipKnown = false;
+	stats.issued++;
+}
+
+void GFW::Render::StateTracker::SetClipRect(const SDL_Rect* rect)
+{
+	bool enable = rect != nullptr;
+	if (clipKnown && enable == clipEnabled && (!enable || SDL_RectEquals(rect, &clip))) {
+		stats.skipped++;
+		return;
+	}
+	SDL_RenderSetClipRect(renderer, rect);
+	clipEnabled = enable;
+	if (enable) {
+		clip = *rect;
+	}
+	clipKnown = true;
+	stats.issued++;
+}
+
+void GFW::Render::StateTracker::SetTextureColorMod(SDL_Texture* texture, Uint8 r, Uint8 g, Uint8 b)
+{
+	//the mods are stored on the texture itself, reading them back is only a field access and can't go stale
+	Uint8 cr, cg, cb;
+	if (SDL_GetTextureColorMod(texture, &cr, &cg, &cb) == 0 && cr == r && cg == g && cb == b) {
+		stats.skipped++;
+		return;
+	}
+	SDL_SetTextureColorMod(texture, r, g, b);
+	stats.issued++;
+}
+
+void GFW::Render::StateTracker::SetTextureAlphaMod(SDL_Texture* texture, Uint8 a)
+{
+	Uint8 ca;
+	if (SDL_GetTextureAlphaMod(texture, &ca) == 0 && ca == a) {
+		stats.skipped++;
+		return;
+	}
+	SDL_SetTextureAlphaMod(texture, a);
+	stats.issued++;
+}
+
+//the screen area covered by a rect rotated around its center, like SDL_RenderCopyEx draws it
+static SDL_Rect RotatedRectBounds(const SDL_Rect& rect, double angle)
+{
+	if (angle == 0) {
+		return rect;
+	}
+
+	GFW::Vector2D center = { rect.x + rect.w / 2, rect.y + rect.h / 2 };
+	GFW::Vector2D corners[4] = { { rect.x, rect.y }, { rect.x + rect.w, rect.y }, { rect.x + rect.w, rect.y + rect.h }, { rect.x, rect.y + rect.h } };
+	int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+
+	for (GFW::Vector2D corner : corners) {
+		GFW::Vector2D p = GFW::Points::RotatePoint(center, corner, angle);
+		minX = min(minX, p.x);
+		minY = min(minY, p.y);
+		maxX = max(maxX, p.x);
+		maxY = max(maxY, p.y);
+	}
+
+	//one pixel of slack for rounding and filtering
+	return { minX - 1, minY - 1, maxX - minX + 3, maxY - minY + 3 };
+}
+
+bool GFW::Points::Points::GetDrawRect(SDL_Rect& rect)
+{
+	return VertexRect(v.data(), static_cast<int>(v.size()), rect);
+}
+
+GFW::Render::RenderState GFW::Image::Image::GetRenderState()
+{
+	Render::RenderState state;
+	state.texture = texture;
+	//a sprite playing in place only changes srcRect, which the dirty rect mode would otherwise never see; frames of
+	//one size differ in their packed position alone, so no two of them share a version
+	Uint32 position = (static_cast<Uint32>(srcRect.x) & 0xFFFF) | static_cast<Uint32>(srcRect.y) << 16;
+	state.version = position ^ (static_cast<Uint32>(srcRect.w) * 2654435761u + static_cast<Uint32>(srcRect.h) * 40503u);
+	return state;
+}
+
+bool GFW::Image::Image::GetDrawRect(SDL_Rect& r)
+{
+	r = RotatedRectBounds(rect, angle);
+	return true;
+}
+
+bool GFW::Text::Text::GetDrawRect(SDL_Rect& rect)
+{
+	rect = RotatedRectBounds({ pos.x, pos.y, size.first, size.second }, angle);
+	return true;
+}
+
+bool GFW::Circle::Circle::GetDrawRect(SDL_Rect& rect)
+{
+	rect = { pos.x - r, pos.y - r, 2 * r + 1, 2 * r + 1 };
+	return true;
+}
+
+void GFW::Render::DamageTracker::Record(Drawable& drawable)
+{
+	Drawable& copy = snapshots.Take(drawable);
+	Entry entry = { &copy, &drawable, { 0, 0, 0, 0 }, copy.GetRenderState(), false, NoEntry };
+	entry.known = copy.GetDrawRect(entry.rect);
+	current.push_back(entry);
+
+	//chains the draws of each source in order, so Collect can pair the n-th draw of both frames
+	size_t index = current.size() - 1;
+	auto inserted = currentIndex.insert({ &drawable, Chain{ index, index } });
+	if (!inserted.second) {
+		current[inserted.first->second.last].nextSame = index;
+		inserted.first->second.last = index;
+	}
+}
+
+void GFW::Render::DamageTracker::Record(const Points::Points& bounds)
+{
+	Entry entry = { &snapshots.Take(bounds), nullptr, { 0, 0, 0, 0 }, RenderState(), false, NoEntry };
+	entry.state = entry.drawable->GetRenderState();
+	entry.known = entry.drawable->GetDrawRect(entry.rect);
+	current.push_back(entry);
+}
+
+static bool SameState(const GFW::Render::RenderState& a, const GFW::Render::RenderState& b)
+{
+	return a.texture == b.texture && a.blendMode == b.blendMode && a.version == b.version
+		&& a.color.r == b.color.r && a.color.g == b.color.g && a.color.b == b.color.b && a.color.a == b.color.a;
+}
+
+void GFW::Render::DamageTracker::Collect()
+{
+	damage.swap(extraDamage);
+	extraDamage.clear();
+
+	vector<bool> seen(previous.size(), false);
+
+	for (const Entry& entry : current) {
+		if (!entry.known) {
+			fullDamage = true;
+			return;
+		}
+		if (entry.source == nullptr) {
+			damage.push_back(entry.rect);
+		}
+	}
+
+	for (const auto& chain : currentIndex) {
+		auto found = previousIndex.find(chain.first);
+		size_t old = found == previousIndex.end() ? NoEntry : found->second.first;
+
+		for (size_t i = chain.second.first; i != NoEntry; i = current[i].nextSame) {
+			const Entry& entry = current[i];
+
+			if (old == NoEntry) {
+				damage.push_back(entry.rect);
+				continue;
+			}
+
+			seen[old] = true;
+			if (!SDL_RectEquals(&previous[old].rect, &entry.rect) || !SameState(previous[old].state, entry.state)) {
+				damage.push_back(previous[old].rect);
+				damage.push_back(entry.rect);
+			}
+			old = previous[old].nextSame;
+		}
+	}
+
+	//whatever was drawn last frame and not this frame (including every copied Points draw) leaves a hole
+	for (size_t i = 0; i < previous.size(); i++) {
+		if (!seen[i]) {
+			if (!previous[i].known) {
+				fullDamage = true;
+				return;
+			}
+			damage.push_back(previous[i].rect);
+		}
+	}
+}
+
+void GFW::Render::DamageTracker::Merge(const SDL_Rect& screen)
+{
+	const size_t maxRects = 32;
+	vector<SDL_Rect> clipped;
+
+	for (const SDL_Rect& rect : damage) {
+		SDL_Rect r;
+		if (SDL_IntersectRect(&rect, &screen, &r)) {
+			clipped.push_back(r);
+		}
+	}
+
+	//overlapping rects are merged into their union until none overlap
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (size_t i = 0; i < clipped.size() && !merged; i++) {
+			for (size_t j = i + 1; j < clipped.size(); j++) {
+				if (SDL_HasIntersection(&clipped[i], &clipped[j])) {
+					SDL_UnionRect(&clipped[i], &clipped[j], &clipped[i]);
+					clipped.erase(clipped.begin() + j);
+					merged = true;
+					break;
+				}
+			}
+		}
+	}
+
+	Sint64 area = 0;
+	for (const SDL_Rect& rect : clipped) {
+		area += static_cast<Sint64>(rect.w) * rect.h;
+	}
+
+	//past this point a single full redraw is cheaper than many small clipped ones
+	if (clipped.size() > maxRects || area * 2 > static_cast<Sint64>(screen.w) * screen.h) {
+		clipped.assign(1, screen);
+	}
+
+	damage.swap(clipped);
+}
+
+void GFW::Render::DamageTracker::Redraw(SDL_Renderer* renderer, StateTracker& state, SDL_Color background, SDL_Rect screen, const Camera* camera)
+{
+	stats = DirtyRectStats();
+
+	//recorded rects are in world coordinates, so they only match the screen through the identity camera
+	bool identity = camera == nullptr || camera->IsIdentity();
+	if (!identity || !lastIdentity) {
+		fullDamage = true;
+	}
+	lastIdentity = identity;
+
+	if (!SameState(RenderState{ nullptr, SDL_BLENDMODE_BLEND, background, 0 }, RenderState{ nullptr, SDL_BLENDMODE_BLEND, lastBackground, 0 })) {
+		fullDamage = true;
+		lastBackground = background;
+	}
+
+	if (!fullDamage) {
+		Collect();
+	}
+	if (fullDamage) {
+		damage.assign(1, screen);
+		extraDamage.clear();
+	}
+	else {
+		Merge(screen);
+	}
+
+	for (const SDL_Rect& rect : damage) {
+		//replaces the old pixels like SDL_RenderClear would, instead of blending over them
+		state.SetClipRect(&rect);
+		state.SetDrawColor(background);
+		state.SetBlendMode(SDL_BLENDMODE_NONE);
+		SDL_RenderFillRect(renderer, &rect);
+		state.SetBlendMode(SDL_BLENDMODE_BLEND);
+
+		stats.rects++;
+		stats.pixels += rect.w * rect.h;
+
+		for (const Entry& entry : current) {
+			if (!entry.known || SDL_HasIntersection(&entry.rect, &rect)) {
+				DrawThrough(*entry.drawable, renderer, camera);
+				stats.drawn++;
+			}
+		}
+	}
+	state.SetClipRect(nullptr);
+
+	for (const Entry& entry : current) {
+		bool touched = !entry.known;
+		for (const SDL_Rect& rect : damage) {
+			touched = touched || SDL_HasIntersection(&entry.rect, &rect);
+		}
+		stats.skipped += touched ? 0 : 1;
+	}
+
+	//the snapshots are only needed as rects from here on
+	previous.swap(current);
+	previousIndex.swap(currentIndex);
+	current.clear();
+	currentIndex.clear();
+	snapshots.Reset();
+	fullDamage = false;
+}
+
+namespace {
+	//draws into a texture until it goes out of scope, then restores the previous target and clip rect (switching
+	//targets drops the clip rect) for whoever is drawing around it, going through the renderer's StateTracker if it has one
+	class TargetScope {
+	public:
+		TargetScope(SDL_Renderer* renderer, SDL_Texture* target) : renderer(renderer), tracker(GFW::Render::StateTracker::Find(renderer))
+		{
+			previousTarget = SDL_GetRenderTarget(renderer);
+			SDL_RenderGetClipRect(renderer, &previousClip);
+			clipped = SDL_RenderIsClipEnabled(renderer) == SDL_TRUE;
+			Set(target, nullptr);
+		}
+		~TargetScope() { Set(previousTarget, clipped ? &previousClip : nullptr); }
+
+		//fills the whole target, leaving the draw color as it was
+		void Clear(SDL_Color color)
+		{
+			SDL_Color drawColor = GFW::GFW_GetRenderDrawColor(renderer);
+			GFW::GFW_SetRenderDrawColor(renderer, color);
+			SDL_RenderClear(renderer);
+			GFW::GFW_SetRenderDrawColor(renderer, drawColor);
+		}
+
+	private:
+		void Set(SDL_Texture* target, const SDL_Rect* clip)
+		{
+			if (tracker != nullptr) {
+				tracker->SetTarget(target);
+				tracker->SetClipRect(clip);
+			}
+			else {
+				SDL_SetRenderTarget(renderer, target);
+				SDL_RenderSetClipRect(renderer, clip);
+			}
+		}
+
+		SDL_Renderer* renderer;
+		GFW::Render::StateTracker* tracker;
+		SDL_Texture* previousTarget;
+		SDL_Rect previousClip;
+		bool clipped;
+	};
+}
+
+void GFW::Render::StaticLayer::Add(Drawable& drawable)
+{
+	Updatable* updatable = dynamic_cast<Updatable*>(&drawable);
+	members.push_back({ &drawable, updatable, updatable != nullptr ? updatable->GetUpdateCount() : 0 });
+	Invalidate();
+}
+
+void GFW::Render::StaticLayer::Remove(Drawable& drawable)
+{
+	members.erase(find_if(members.begin(), members.end(), [&drawable](const Member& m) { return m.drawable == &drawable; }));
+	Invalidate();
+}
+
+void GFW::Render::StaticLayer::Destroy()
+{
+	if (texture != nullptr) {
+		SDL_DestroyTexture(texture);
+		texture = nullptr;
+	}
+	dirty = true;
+}
+
+bool GFW::Render::StaticLayer::Changed()
+{
+	bool changed = dirty;
+
+	for (Member& member : members) {
+		if (member.updatable != nullptr) {
+			Uint32 count = member.updatable->GetUpdateCount();
+			changed = changed || count != member.updateCount;
+			member.updateCount = count;
+		}
+	}
+
+	return changed;
+}
+
+void GFW::Render::StaticLayer::Render(SDL_Renderer* renderer)
+{
+	int outW, outH;
+	SDL_GetRendererOutputSize(renderer, &outW, &outH);
+
+	if (texture != nullptr && (outW != w || outH != h)) {
+		Destroy();
+	}
+	if (texture == nullptr) {
+		texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, outW, outH);
+
+		if (texture == nullptr) {
+			return;
+		}
+		//members were blended into the cleared texture, so its colors are premultiplied and blending them again would
+		//apply their alpha twice
+		premultiplied = SDL_SetTextureBlendMode(texture, Image::PremultipliedBlendMode()) == 0;
+		if (!premultiplied) {
+			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		}
+		w = outW;
+		h = outH;
+	}
+
+	{
+		TargetScope scope(renderer, texture);
+		scope.Clear({ 0, 0, 0, 0 });
+
+		for (Member& member : members) {
+			member.drawable->Draw(renderer);
+		}
+
+		//renderers without custom blend modes (like the software one) get the layer back as straight alpha instead
+		if (!premultiplied) {
+			SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+
+			if (surface == nullptr || SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, surface->pixels, surface->pitch) != 0) {
+				cerr << "error: " << SDL_GetError() << endl;
+			}
+			else {
+				Unpremultiply(surface);
+				SDL_UpdateTexture(texture, NULL, surface->pixels, surface->pitch);
+			}
+			SDL_FreeSurface(surface);
+		}
+	}
+
+	dirty = false;
+	renderCount++;
+}
+
+void GFW::Render::StaticLayer::Draw(SDL_Renderer* renderer)
+{
+	if (Changed() || texture == nullptr) {
+		Render(renderer);
+	}
+
+	if (texture != nullptr) {
+		SDL_RenderCopy(renderer, texture, NULL, NULL);
+	}
+}
+
+void GFW::Render::StaticLayer::DrawTransformed(SDL_Renderer* renderer, const Camera& camera)
+{
+	if (camera.IsIdentity()) {
+		Draw(renderer);
+		return;
+	}
+
+	if (Changed() || texture == nullptr) {
+		Render(renderer);
+	}
+
+	//the cached texture covers the world area its members were rendered at
+	if (texture != nullptr) {
+		double angle = 0;
+		SDL_Rect dst = CameraRect(camera, { 0, 0, w, h }, angle);
+		SDL_RenderCopyEx(renderer, texture, NULL, &dst, angle, NULL, SDL_FLIP_NONE);
+	}
+}
+
+bool GFW::Render::StaticLayer::Rasterize(SoftwareRenderer& target, const Camera& camera)
+{
+	for (Member& member : members) {
+		target.Submit(*member.drawable, camera);
+	}
+	return true;
+}
+
+GFW::Render::RenderState GFW::Render::StaticLayer::GetRenderState()
+{
+	//a pending re-render shows up as a new version, so the dirty rect mode redraws this layer
+	dirty = Changed();
+
+	RenderState state;
+	state.texture = texture;
+	state.version = renderCount + (dirty ? 1 : 0);
+
+	if (texture != nullptr) {
+		SDL_GetTextureBlendMode(texture, &state.blendMode);
+	}
+	return state;
+}
+
+bool GFW::Render::StaticLayer::GetDrawRect(SDL_Rect& rect)
+{
+	if (texture == nullptr) {
+		return false;
+	}
+
+	rect = { 0, 0, w, h };
+	return true;
+}
+
+SDL_Rect GFW::Render::Camera::GetViewport() const
+{
+	return viewport.w > 0 && viewport.h > 0 ? viewport : SDL_Rect{ 0, 0, screenW, screenH };
+}
+
+void GFW::Render::Camera::WorldToScreen(double wx, double wy, double& sx, double& sy) const
+{
+	SDL_Rect vp = GetViewport();
+	double angle = -rotation * (M_PI / 180);
+	double dx = wx - (x + vp.w / 2.0), dy = wy - (y + vp.h / 2.0);
+
+	sx = vp.x + vp.w / 2.0 + zoom * (cos(angle) * dx - sin(angle) * dy);
+	sy = vp.y + vp.h / 2.0 + zoom * (sin(angle) * dx + cos(angle) * dy);
+}
+
+GFW::Vector2D GFW::Render::Camera::WorldToScreen(Vector2D world) const
+{
+	if (IsIdentity()) {
+		return world;
+	}
+
+	double sx, sy;
+	WorldToScreen(world.x, world.y, sx, sy);
+	return { static_cast<int>(lround(sx)), static_cast<int>(lround(sy)) };
+}
+
+GFW::Vector2D GFW::Render::Camera::ScreenToWorld(Vector2D screen) const
+{
+	if (IsIdentity()) {
+		return screen;
+	}
+
+	SDL_Rect vp = GetViewport();
+	double angle = rotation * (M_PI / 180);
+	double dx = (screen.x - (vp.x + vp.w / 2.0)) / zoom, dy = (screen.y - (vp.y + vp.h / 2.0)) / zoom;
+
+	return { static_cast<int>(lround(x + vp.w / 2.0 + cos(angle) * dx - sin(angle) * dy)),
+		static_cast<int>(lround(y + vp.h / 2.0 + sin(angle) * dx + cos(angle) * dy)) };
+}
+
+SDL_Rect GFW::Render::Camera::GetViewBounds() const
+{
+	SDL_Rect vp = GetViewport();
+
+	if (IsIdentity()) {
+		return vp;
+	}
+
+	double key[10] = { x, y, zoom, rotation, double(vp.x), double(vp.y), double(vp.w), double(vp.h), double(screenW), double(screenH) };
+	if (boundsKnown && equal(key, key + 10, boundsKey)) {
+		return bounds;
+	}
+
+	Vector2D corners[4] = { { vp.x, vp.y }, { vp.x + vp.w, vp.y }, { vp.x + vp.w, vp.y + vp.h }, { vp.x, vp.y + vp.h } };
+	int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+
+	for (Vector2D corner : corners) {
+		Vector2D p = ScreenToWorld(corner);
+		minX = min(minX, p.x);
+		minY = min(minY, p.y);
+		maxX = max(maxX, p.x);
+		maxY = max(maxY, p.y);
+	}
+
+	//one unit of slack for the rounding above
+	bounds = { minX - 1, minY - 1, maxX - minX + 3, maxY - minY + 3 };
+	copy(key, key + 10, boundsKey);
+	boundsKnown = true;
+
+	return bounds;
+}
+
+bool GFW::Render::Camera::IsVisible(const SDL_Rect& world) const
+{
+	SDL_Rect view = GetViewBounds();
+
+	//without a known screen size nothing can be ruled out
+	if (view.w <= 0 || view.h <= 0) {
+		return true;
+	}
+
+	return SDL_HasIntersection(&world, &view) == SDL_TRUE;
+}
+
+void GFW::Render::SpatialGrid::Insert(Drawable& drawable)
+{
+	Remove(drawable);
+
+	Item item;
+	item.known = drawable.GetDrawRect(item.rect);
+	item.sequence = sequence++;
+	items[&drawable] = item;
+
+	if (!item.known) {
+		unbounded.push_back(&drawable);
+		return;
+	}
+
+	for (int cy = CellOf(item.rect.y); cy <= CellOf(item.rect.y + item.rect.h - 1); cy++) {
+		for (int cx = CellOf(item.rect.x); cx <= CellOf(item.rect.x + item.rect.w - 1); cx++) {
+			cells[CellKey(cx, cy)].push_back(&drawable);
+		}
+	}
+}
+
+void GFW::Render::SpatialGrid::Remove(Drawable& drawable)
+{
+	auto found = items.find(&drawable);
+
+	if (found == items.end()) {
+		return;
+	}
+
+	const Item& item = found->second;
+	Drawable* target = &drawable;
+
+	if (!item.known) {
+		unbounded.erase(find(unbounded.begin(), unbounded.end(), target));
+	}
+	else {
+		for (int cy = CellOf(item.rect.y); cy <= CellOf(item.rect.y + item.rect.h - 1); cy++) {
+			for (int cx = CellOf(item.rect.x); cx <= CellOf(item.rect.x + item.rect.w - 1); cx++) {
+				auto cell = cells.find(CellKey(cx, cy));
+				vector<Drawable*>& members = cell->second;
+
+				//order inside a cell doesn't matter, Query sorts by sequence
+				*find(members.begin(), members.end(), target) = members.back();
+				members.pop_back();
+
+				if (members.empty()) {
+					cells.erase(cell);
+				}
+			}
+		}
+	}
+
+	items.erase(found);
+}
+
+void GFW::Render::SpatialGrid::Query(const SDL_Rect& area, vector<Drawable*>& out)
+{
+	//reused between calls so querying doesn't allocate once it has grown
+	static vector<pair<Uint32, Drawable*>> found;
+	found.clear();
+
+	auto test = [this, &area](Drawable* drawable) {
+		const Item& item = items[drawable];
+		if (SDL_HasIntersection(&item.rect, &area)) {
+			found.push_back({ item.sequence, drawable });
+		}
+	};
+
+	int minX = CellOf(area.x), maxX = CellOf(area.x + area.w - 1);
+	int minY = CellOf(area.y), maxY = CellOf(area.y + area.h - 1);
+
+	//a view much larger than the occupied cells is cheaper to answer by walking the cells
+	if (static_cast<Sint64>(maxX - minX + 1) * (maxY - minY + 1) > static_cast<Sint64>(cells.size())) {
+		for (auto& cell : cells) {
+			for (Drawable* drawable : cell.second) {
+				test(drawable);
+			}
+		}
+	}
+	else {
+		for (int cy = minY; cy <= maxY; cy++) {
+			for (int cx = minX; cx <= maxX; cx++) {
+				auto cell = cells.find(CellKey(cx, cy));
+				if (cell != cells.end()) {
+					for (Drawable* drawable : cell->second) {
+						test(drawable);
+					}
+				}
+			}
+		}
+	}
+
+	for (Drawable* drawable : unbounded) {
+		found.push_back({ items[drawable].sequence, drawable });
+	}
+
+	//objects spanning several cells are found once per cell
+	sort(found.begin(), found.end());
+	found.erase(unique(found.begin(), found.end()), found.end());
+
+	out.clear();
+	for (const pair<Uint32, Drawable*>& entry : found) {
+		out.push_back(entry.second);
+	}
+}
+
+GFW::Render::WorkerPool::WorkerPool(int threads)
+	: threads(threads > 0 ? threads : max(1, static_cast<int>(thread::hardware_concurrency()))), next(0)
+{
+}
+
+GFW::Render::WorkerPool::~WorkerPool()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		quitting = true;
+	}
+	wake.notify_all();
+
+	for (thread& worker : workers) {
+		worker.join();
+	}
+}
+
+GFW::Render::WorkerPool& GFW::Render::WorkerPool::Shared()
+{
+	static WorkerPool pool;
+	return pool;
+}
+
+void GFW::Render::WorkerPool::Run(int count, const function<void(int)>& f)
+{
+	lock_guard<mutex> batch(running);
+
+	if (count <= 1 || threads == 1) {
+		for (int i = 0; i < count; i++) {
+			f(i);
+		}
+		return;
+	}
+
+	//the thread calling Run works on jobs too
+	if (workers.empty()) {
+		for (int i = 1; i < threads; i++) {
+			workers.emplace_back(&WorkerPool::Work, this);
+		}
+	}
+
+	job = &f;
+	jobs = count;
+	next = 0;
+	{
+		lock_guard<mutex> guard(lock);
+		busy = static_cast<int>(workers.size());
+		generation++;
+	}
+	wake.notify_all();
+
+	Drain();
+
+	{
+		unique_lock<mutex> guard(lock);
+		finished.wait(guard, [this]() { return busy == 0; });
+	}
+	job = nullptr;
+}
+
+void GFW::Render::WorkerPool::Drain()
+{
+	for (int i = next++; i < jobs; i = next++) {
+		(*job)(i);
+	}
+}
+
+void GFW::Render::WorkerPool::Work()
+{
+	Uint32 seen = 0;
+
+	while (true) {
+		{
+			unique_lock<mutex> guard(lock);
+			wake.wait(guard, [this, seen]() { return quitting || generation != seen; });
+
+			if (quitting) {
+				return;
+			}
+			seen = generation;
+		}
+
+		Drain();
+
+		{
+			lock_guard<mutex> guard(lock);
+			if (--busy == 0) {
+				finished.notify_one();
+			}
+		}
+	}
+}
+
+vector<GFW::Render::SoftwareRenderer*> GFW::Render::SoftwareRenderer::attached;
+
+GFW::Render::SoftwareRenderer::SoftwareRenderer(int w, int h, int threads, int tileSize)
+	: w(w), h(h), tileSize(tileSize), pixels(static_cast<size_t>(w) * h, 0), ownPool(threads), pool(threads > 0 ? &ownPool : &WorkerPool::Shared())
+{
+	tilesX = (w + tileSize - 1) / tileSize;
+	tilesY = (h + tileSize - 1) / tileSize;
+	bins.resize(tilesX * tilesY);
+}
+
+GFW::Render::SoftwareRenderer::~SoftwareRenderer()
+{
+	Detach();
+
+	for (auto& entry : surfaces) {
+		SDL_FreeSurface(entry.second);
+	}
+}
+
+void GFW::Render::SoftwareRenderer::Attach(SDL_Renderer* r)
+{
+	Detach();
+	renderer = r;
+	attached.push_back(this);
+}
+
+void GFW::Render::SoftwareRenderer::Detach()
+{
+	if (renderer != nullptr) {
+		attached.erase(find(attached.begin(), attached.end(), this));
+		renderer = nullptr;
+	}
+}
+
+GFW::Render::SoftwareRenderer* GFW::Render::SoftwareRenderer::Find(SDL_Renderer* r)
+{
+	for (SoftwareRenderer* software : attached) {
+		if (software->renderer == r) {
+			return software;
+		}
+	}
+	return nullptr;
+}
+
+void GFW::Render::SoftwareRenderer::CaptureTexture(SDL_Renderer* r, SDL_Texture* texture, SDL_Surface* surface)
+{
+	SoftwareRenderer* software = Find(r);
+
+	if (software == nullptr || texture == nullptr || surface == nullptr) {
+		return;
+	}
+
+	SDL_Surface* copy = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+
+	if (copy == nullptr) {
+		return;
+	}
+
+	SDL_Surface*& slot = software->surfaces[texture];
+	if (slot != nullptr) {
+		SDL_FreeSurface(slot);
+	}
+	slot = copy;
+}
+
+void GFW::Render::SoftwareRenderer::ReleaseTexture(SDL_Texture* texture)
+{
+	for (SoftwareRenderer* software : attached) {
+		auto found = software->surfaces.find(texture);
+
+		if (found != software->surfaces.end()) {
+			SDL_FreeSurface(found->second);
+			software->surfaces.erase(found);
+		}
+	}
+}
+
+void GFW::Render::SoftwareRenderer::Record(CommandKind kind, SDL_Color color, SDL_Rect bounds, int first, int count)
+{
+	SDL_Rect screen = { 0, 0, w, h };
+	SDL_Rect clipped;
+
+	if (!SDL_IntersectRect(&bounds, &screen, &clipped)) {
+		return;
+	}
+
+	Uint32 argb = static_cast<Uint32>(color.a) << 24 | color.r << 16 | color.g << 8 | color.b;
+	commands.push_back({ kind, argb, clipped, first, count });
+}
+
+SDL_Surface* GFW::Render::SoftwareRenderer::ReadBack(SDL_Texture* texture)
+{
+	int tw = 0, th = 0;
+
+	if (renderer == nullptr || SDL_QueryTexture(texture, NULL, NULL, &tw, &th) != 0) {
+		return nullptr;
+	}
+
+	SDL_Texture* copy = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, tw, th);
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, tw, th, 32, SDL_PIXELFORMAT_ARGB8888);
+
+	if (copy == nullptr || surface == nullptr) {
+		cerr << "error: " << SDL_GetError() << endl;
+		if (copy != nullptr) {
+			SDL_DestroyTexture(copy);
+		}
+		SDL_FreeSurface(surface);
+		return nullptr;
+	}
+
+	//the texels are copied as they are, so its mods and blend mode are switched off for the copy
+	SDL_BlendMode mode;
+	Uint8 r, g, b, a;
+	SDL_GetTextureBlendMode(texture, &mode);
+	SDL_GetTextureColorMod(texture, &r, &g, &b);
+	SDL_GetTextureAlphaMod(texture, &a);
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+	SDL_SetTextureColorMod(texture, 255, 255, 255);
+	SDL_SetTextureAlphaMod(texture, 255);
+
+	int result;
+	{
+		TargetScope scope(renderer, copy);
+		SDL_RenderCopy(renderer, texture, NULL, NULL);
+		result = SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, surface->pixels, surface->pitch);
+	}
+
+	SDL_SetTextureBlendMode(texture, mode);
+	SDL_SetTextureColorMod(texture, r, g, b);
+	SDL_SetTextureAlphaMod(texture, a);
+	SDL_DestroyTexture(copy);
+
+	if (result != 0) {
+		cerr << "error: " << SDL_GetError() << endl;
+		SDL_FreeSurface(surface);
+		return nullptr;
+	}
+
+	//quads are blended with straight alpha
+	if (mode == Image::PremultipliedBlendMode() && mode != SDL_BLENDMODE_BLEND) {
+		Unpremultiply(surface);
+	}
+
+	return surface;
+}
+
+void GFW::Render::SoftwareRenderer::Clear(SDL_Color color)
+{
+	//everything before a clear is hidden by it
+	commands.clear();
+	rects.clear();
+	points.clear();
+	quads.clear();
+	modulations.clear();
+
+	color.a = 255;
+	Record(COMMAND_CLEAR, color, { 0, 0, w, h }, 0, 0);
+}
+
+void GFW::Render::SoftwareRenderer::Modulate(const Uint32* p, const SDL_Rect& area)
+{
+	if (area.w <= 0 || area.h <= 0) {
+		return;
+	}
+
+	modulations.push_back({ p, area });
+	Record(COMMAND_MODULATE, { 255, 255, 255, 255 }, area, static_cast<int>(modulations.size()) - 1, 1);
+}
+
+bool GFW::Render::SoftwareRenderer::CopyEx(SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect& dst, double angle)
+{
+	if (texture == nullptr || dst.w <= 0 || dst.h <= 0) {
+		return true;
+	}
+
+	SDL_Surface*& surface = surfaces[texture];
+
+	//textures created before this renderer was attached, or not by GFW, are captured on first use
+	if (surface == nullptr) {
+		surface = ReadBack(texture);
+
+		if (surface == nullptr) {
+			surfaces.erase(texture);
+			return false;
+		}
+	}
+
+	Quad quad;
+	quad.surface = surface;
+	quad.src = src != nullptr ? *src : SDL_Rect{ 0, 0, quad.surface->w, quad.surface->h };
+	quad.cx = dst.x + dst.w / 2.0;
+	quad.cy = dst.y + dst.h / 2.0;
+	quad.cosA = cos(angle * (M_PI / 180));
+	quad.sinA = sin(angle * (M_PI / 180));
+	quad.halfW = dst.w / 2.0;
+	quad.halfH = dst.h / 2.0;
+
+	SDL_GetTextureColorMod(texture, &quad.r, &quad.g, &quad.b);
+	SDL_GetTextureAlphaMod(texture, &quad.a);
+
+	//the rotated quad's screen bounds, with a pixel of slack for rounding
+	double extentX = fabs(quad.cosA) * quad.halfW + fabs(quad.sinA) * quad.halfH;
+	double extentY = fabs(quad.sinA) * quad.halfW + fabs(quad.cosA) * quad.halfH;
+	int minX = static_cast<int>(floor(quad.cx - extentX)) - 1, minY = static_cast<int>(floor(quad.cy - extentY)) - 1;
+	int maxX = static_cast<int>(ceil(quad.cx + extentX)) + 1, maxY = static_cast<int>(ceil(quad.cy + extentY)) + 1;
+
+	quads.push_back(quad);
+	Record(COMMAND_QUAD, { 255, 255, 255, 255 }, { minX, minY, maxX - minX, maxY - minY }, static_cast<int>(quads.size()) - 1, 1);
+	return true;
+}
+
+void GFW::Render::SoftwareRenderer::FillRects(const SDL_Rect* r, int count, SDL_Color color)
+{
+	//each rect is binned on its own, so scattered rects (particles, spans) only reach the tiles they touch
+	for (int i = 0; i < count; i++) {
+		rects.push_back(r[i]);
+		Record(COMMAND_RECTS, color, r[i], static_cast<int>(rects.size()) - 1, 1);
+	}
+}
+
+void GFW::Render::SoftwareRenderer::DrawLines(const SDL_Point* p, int count, SDL_Color color)
+{
+	if (count <= 0) {
+		return;
+	}
+
+	int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+	for (int i = 0; i < count; i++) {
+		minX = min(minX, p[i].x);
+		minY = min(minY, p[i].y);
+		maxX = max(maxX, p[i].x);
+		maxY = max(maxY, p[i].y);
+	}
+
+	int first = static_cast<int>(points.size());
+	points.insert(points.end(), p, p + count);
+	Record(COMMAND_LINES, color, { minX, minY, maxX - minX + 1, maxY - minY + 1 }, first, count);
+}
+
+void GFW::Render::SoftwareRenderer::FillPolygon(const SDL_Point* p, int count, SDL_Color color)
+{
+	if (count < 3) {
+		return;
+	}
+
+	int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+	for (int i = 0; i < count; i++) {
+		minX = min(minX, p[i].x);
+		minY = min(minY, p[i].y);
+		maxX = max(maxX, p[i].x);
+		maxY = max(maxY, p[i].y);
+	}
+
+	int first = static_cast<int>(points.size());
+	points.insert(points.end(), p, p + count);
+	Record(COMMAND_POLYGON, color, { minX, minY, maxX - minX + 1, maxY - minY + 1 }, first, count);
+}
+
+void GFW::Render::SoftwareRenderer::Submit(Drawable& drawable, const Camera& camera)
+{
+	if (!drawable.Rasterize(*this, camera)) {
+		stats.unsupported++;
+	}
+}
+
+void GFW::Render::SoftwareRenderer::Rasterize()
+{
+	for (vector<int>& bin : bins) {
+		bin.clear();
+	}
+
+	//binning keeps each tile's commands in the order they were recorded
+	for (size_t i = 0; i < commands.size(); i++) {
+		const SDL_Rect& bounds = commands[i].bounds;
+
+		for (int ty = bounds.y / tileSize; ty <= (bounds.y + bounds.h - 1) / tileSize; ty++) {
+			for (int tx = bounds.x / tileSize; tx <= (bounds.x + bounds.w - 1) / tileSize; tx++) {
+				bins[ty * tilesX + tx].push_back(static_cast<int>(i));
+				stats.binned++;
+			}
+		}
+	}
+
+	pool->Run(tilesX * tilesY, [this](int tile) { RasterTile(tile); });
+
+	stats.commands = static_cast<int>(commands.size());
+	stats.tiles = tilesX * tilesY;
+	stats.threads = pool->GetThreads();
+	lastStats = stats;
+	stats = SoftwareRasterStats();
+
+	commands.clear();
+	rects.clear();
+	points.clear();
+	quads.clear();
+	modulations.clear();
+}
+
+void GFW::Render::SoftwareRenderer::Present(SDL_Renderer* r)
+{
+	Rasterize();
+
+	if (upload == nullptr) {
+		upload = SDL_CreateTexture(r, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+
+		if (upload == nullptr) {
+			cerr << "error: " << SDL_GetError() << endl;
+			return;
+		}
+		SDL_SetTextureBlendMode(upload, SDL_BLENDMODE_NONE);
+	}
+
+	SDL_UpdateTexture(upload, NULL, pixels.data(), w * static_cast<int>(sizeof(Uint32)));
+	SDL_RenderCopy(r, upload, NULL, NULL);
+}
+
+void GFW::Render::SoftwareRenderer::Destroy()
+{
+	if (upload != nullptr) {
+		SDL_DestroyTexture(upload);
+		upload = nullptr;
+	}
+}
+
+#ifdef GFW_SSE2
+//the blend of BlendPixel on 16 bit lanes: s is the source with its alpha lane at 255 and already multiplied by its
+//alpha (plus 128 for rounding), ia is 255 minus the source alpha, and each lane is divided by 255 with rounding
+static inline __m128i BlendLanes(__m128i s, __m128i d, __m128i ia)
+{
+	__m128i sum = _mm_add_epi16(s, _mm_mullo_epi16(d, ia));
+	return _mm_srli_epi16(_mm_add_epi16(sum, _mm_srli_epi16(sum, 8)), 8);
+}
+#endif
+
+//src over dst with straight alpha like SDL_BLENDMODE_BLEND, two 8 bit channels per 32 bit multiply (or one
+//pixel in SSE2 lanes)
+static inline Uint32 BlendPixel(Uint32 src, Uint32 dst)
+{
+	Uint32 a = src >> 24;
+
+	if (a == 255) {
+		return src;
+	}
+	if (a == 0) {
+		return dst;
+	}
+
+	Uint32 ia = 255 - a;
+
+#ifdef GFW_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	__m128i s = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(src | 0xFF000000)), zero);
+	__m128i d = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(dst)), zero);
+	s = _mm_add_epi16(_mm_mullo_epi16(s, _mm_set1_epi16(static_cast<short>(a))), _mm_set1_epi16(128));
+
+	__m128i result = BlendLanes(s, d, _mm_set1_epi16(static_cast<short>(ia)));
+	return static_cast<Uint32>(_mm_cvtsi128_si32(_mm_packus_epi16(result, zero)));
+#else
+
+	//red and blue share one word, alpha and green the other (the source alpha lane is 255 so alpha accumulates)
+	Uint32 rb = (src & 0x00FF00FF) * a + (dst & 0x00FF00FF) * ia + 0x00800080;
+	Uint32 ag = (0x00FF0000 | ((src >> 8) & 0xFF)) * a + ((dst >> 8) & 0x00FF00FF) * ia + 0x00800080;
+
+	//dividing each lane by 255 with rounding
+	rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+	ag = ((ag + ((ag >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+
+	return rb | ag << 8;
+#endif
+}
+
+//src over dst with straight alpha where dst may be translucent too, which BlendPixel assumes it isn't:
+//the result's alpha is a + dA(1 - a) and its colors are the weighted average (c a + d dA(1 - a)) / that alpha
+static inline Uint32 BlendOver(Uint32 src, Uint32 dst)
+{
+	Uint32 a = src >> 24, dA = dst >> 24;
+
+	if (a == 255 || a == 0 || dA == 255) {
+		return BlendPixel(src, dst);
+	}
+
+	//the weights are in 255 * 255 units, and a > 0 so their sum is never 0
+	Uint32 ws = a * 255, wd = dA * (255 - a), total = ws + wd;
+
+	auto channel = [&](int shift) {
+		Uint32 c = (src >> shift) & 0xFF, d = (dst >> shift) & 0xFF;
+		return ((c * ws + d * wd + total / 2) / total) << shift;
+	};
+	return (total + 127) / 255 << 24 | channel(16) | channel(8) | channel(0);
+}
+
+static inline void BlendSpan(Uint32* row, int count, Uint32 color)
+{
+	if (color >> 24 == 255) {
+		fill(row, row + count, color);
+		return;
+	}
+
+	int i = 0;
+
+#ifdef GFW_SSE2
+	//four pixels at a time, the source side of the blend is the same for all of them
+	Uint32 a = color >> 24;
+	if (a != 0) {
+		const __m128i zero = _mm_setzero_si128();
+		__m128i s = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color | 0xFF000000)), zero);
+		s = _mm_add_epi16(_mm_mullo_epi16(s, _mm_set1_epi16(static_cast<short>(a))), _mm_set1_epi16(128));
+		__m128i ia = _mm_set1_epi16(static_cast<short>(255 - a));
+
+		for (; i + 4 <= count; i += 4) {
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+			__m128i low = BlendLanes(s, _mm_unpacklo_epi8(d, zero), ia);
+			__m128i high = BlendLanes(s, _mm_unpackhi_epi8(d, zero), ia);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_packus_epi16(low, high));
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+		row[i] = BlendPixel(color, row[i]);
+	}
+}
+
+static inline Uint8 ModulateChannel(Uint32 value, Uint8 mod)
+{
+	return static_cast<Uint8>((value * mod + 127) / 255);
+}
+
+void GFW::Render::SoftwareRenderer::RasterTile(int tile)
+{
+	SDL_Rect area = { (tile % tilesX) * tileSize, (tile / tilesX) * tileSize, 0, 0 };
+	area.w = min(tileSize, w - area.x);
+	area.h = min(tileSize, h - area.y);
+
+	//crossings of the current polygon row, local to this call so threads don't share it
+	vector<double> crossings;
+
+	for (int index : bins[tile]) {
+		const Command& command = commands[index];
+		SDL_Rect clip;
+
+		if (!SDL_IntersectRect(&command.bounds, &area, &clip)) {
+			continue;
+		}
+
+		switch (command.kind) {
+		case COMMAND_CLEAR:
+			for (int y = clip.y; y < clip.y + clip.h; y++) {
+				fill(&pixels[y * w + clip.x], &pixels[y * w + clip.x] + clip.w, command.color);
+			}
+			break;
+
+		case COMMAND_RECTS:
+			for (int i = command.first; i < command.first + command.count; i++) {
+				SDL_Rect span;
+				if (SDL_IntersectRect(&rects[i], &clip, &span)) {
+					for (int y = span.y; y < span.y + span.h; y++) {
+						BlendSpan(&pixels[y * w + span.x], span.w, command.color);
+					}
+				}
+			}
+			break;
+
+		case COMMAND_LINES:
+			//a single point is drawn as a dot, like SDL_RenderDrawLines
+			for (int i = 0; i < max(1, command.count - 1); i++) {
+				const SDL_Point& from = points[command.first + i];
+				const SDL_Point& to = points[command.first + min(i + 1, command.count - 1)];
+				int x = from.x, y = from.y;
+				int dx = abs(to.x - x), dy = -abs(to.y - y);
+				int sx = x < to.x ? 1 : -1, sy = y < to.y ? 1 : -1;
+				int err = dx + dy;
+
+				while (true) {
+					if (x >= clip.x && x < clip.x + clip.w && y >= clip.y && y < clip.y + clip.h) {
+						pixels[y * w + x] = BlendPixel(command.color, pixels[y * w + x]);
+					}
+					if (x == to.x && y == to.y) {
+						break;
+					}
+					int e2 = 2 * err;
+					if (e2 >= dy) { err += dy; x += sx; }
+					if (e2 <= dx) { err += dx; y += sy; }
+				}
+			}
+			break;
+
+		case COMMAND_POLYGON:
+			for (int y = clip.y; y < clip.y + clip.h; y++) {
+				double cy = y + 0.5;
+				crossings.clear();
+
+				for (int i = 0; i < command.count; i++) {
+					const SDL_Point& a = points[command.first + i];
+					const SDL_Point& b = points[command.first + (i + 1) % command.count];
+
+					if ((a.y <= cy) != (b.y <= cy)) {
+						crossings.push_back(a.x + (cy - a.y) * (b.x - a.x) / (b.y - a.y));
+					}
+				}
+				sort(crossings.begin(), crossings.end());
+
+				//pixels whose centers lie between a pair of crossings are inside
+				for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+					int from = max(clip.x, static_cast<int>(ceil(crossings[i] - 0.5)));
+					int to = min(clip.x + clip.w, static_cast<int>(ceil(crossings[i + 1] - 0.5)));
+
+					if (to > from) {
+						BlendSpan(&pixels[y * w + from], to - from, command.color);
+					}
+				}
+			}
+			break;
+
+		case COMMAND_QUAD: {
+			const Quad& quad = quads[command.first];
+			const Uint32* texels = static_cast<const Uint32*>(quad.surface->pixels);
+			int pitch = quad.surface->pitch / static_cast<int>(sizeof(Uint32));
+			double uScale = quad.src.w / (2 * quad.halfW), vScale = quad.src.h / (2 * quad.halfH);
+			bool modulated = quad.r != 255 || quad.g != 255 || quad.b != 255 || quad.a != 255;
+
+			for (int y = clip.y; y < clip.y + clip.h; y++) {
+				double dy = y + 0.5 - quad.cy;
+
+				for (int x = clip.x; x < clip.x + clip.w; x++) {
+					double dx = x + 0.5 - quad.cx;
+
+					//undoing the clockwise rotation gives the position inside the unrotated rect
+					double u = quad.cosA * dx + quad.sinA * dy + quad.halfW;
+					double v = -quad.sinA * dx + quad.cosA * dy + quad.halfH;
+
+					if (u < 0 || v < 0 || u >= 2 * quad.halfW || v >= 2 * quad.halfH) {
+						continue;
+					}
+
+					int tx = min(quad.src.x + static_cast<int>(u * uScale), quad.src.x + quad.src.w - 1);
+					int ty = min(quad.src.y + static_cast<int>(v * vScale), quad.src.y + quad.src.h - 1);
+					Uint32 texel = texels[ty * pitch + tx];
+
+					if (modulated) {
+						texel = static_cast<Uint32>(ModulateChannel(texel >> 24, quad.a)) << 24
+							| ModulateChannel((texel >> 16) & 0xFF, quad.r) << 16
+							| ModulateChannel((texel >> 8) & 0xFF, quad.g) << 8
+							| ModulateChannel(texel & 0xFF, quad.b);
+					}
+
+					pixels[y * w + x] = BlendPixel(texel, pixels[y * w + x]);
+				}
+			}
+			break;
+		}
+
+		case COMMAND_MODULATE: {
+			//the framebuffer keeps its alpha, like SDL_BLENDMODE_MOD
+			const Modulation& modulation = modulations[command.first];
+
+			for (int y = clip.y; y < clip.y + clip.h; y++) {
+				const Uint32* from = modulation.pixels + static_cast<size_t>(y - modulation.area.y) * modulation.area.w + (clip.x - modulation.area.x);
+				Uint32* to = &pixels[y * w + clip.x];
+
+				for (int i = 0; i < clip.w; i++) {
+					Uint32 m = from[i], d = to[i];
+					to[i] = (d & 0xFF000000) | ModulateChannel((d >> 16) & 0xFF, (m >> 16) & 0xFF) << 16
+						| ModulateChannel((d >> 8) & 0xFF, (m >> 8) & 0xFF) << 8 | ModulateChannel(d & 0xFF, m & 0xFF);
+				}
+			}
+			break;
+		}
+		}
+	}
+}
+
+void GFW::Render::FrameCapture::Start(string pathPrefix, CaptureFormat f, int writerCount, int buffers)
+{
+	Stop();
+
+	prefix = pathPrefix;
+	format = f;
+	frameNumber = 0;
+	stats = FrameCaptureStats();
+	readTicks = 0;
+	encodeTicks = 0;
+
+	//the buffers are allocated once, the pool is also what bounds the queue
+	frames.assign(max(1, buffers), Frame());
+	freeFrames.clear();
+	for (Frame& frame : frames) {
+		freeFrames.push_back(&frame);
+	}
+
+	stopping = false;
+	for (int i = 0; i < max(1, writerCount); i++) {
+		writers.emplace_back(&FrameCapture::Write, this);
+	}
+	running = true;
+}
+
+void GFW::Render::FrameCapture::Stop()
+{
+	if (!running) {
+		return;
+	}
+
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (thread& writer : writers) {
+		writer.join();
+	}
+	writers.clear();
+	running = false;
+}
+
+bool GFW::Render::FrameCapture::Capture(SDL_Renderer* renderer, int w, int h)
+{
+	Frame* frame = nullptr;
+	{
+		lock_guard<mutex> guard(lock);
+		stats.captured++;
+
+		if (freeFrames.empty()) {
+			stats.dropped++;
+			frameNumber++;
+			return false;
+		}
+		frame = freeFrames.back();
+		freeFrames.pop_back();
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	frame->pixels.resize(static_cast<size_t>(w) * h);
+	frame->w = w;
+	frame->h = h;
+	frame->number = frameNumber++;
+	bool read = SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, frame->pixels.data(), w * static_cast<int>(sizeof(Uint32))) == 0;
+
+	Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+	{
+		lock_guard<mutex> guard(lock);
+		readTicks += elapsed;
+
+		if (!read) {
+			stats.dropped++;
+			freeFrames.push_back(frame);
+			return false;
+		}
+		queued.push_back(frame);
+	}
+	wake.notify_one();
+	return true;
+}
+
+GFW::Render::FrameCaptureStats GFW::Render::FrameCapture::GetStats()
+{
+	lock_guard<mutex> guard(lock);
+
+	FrameCaptureStats result = stats;
+	double msPerTick = 1000.0 / SDL_GetPerformanceFrequency();
+	int read = stats.captured - stats.dropped;
+
+	result.readMs = read > 0 ? readTicks * msPerTick / read : 0;
+	result.encodeMs = stats.written > 0 ? encodeTicks * msPerTick / stats.written : 0;
+	return result;
+}
+
+void GFW::Render::FrameCapture::Write()
+{
+	while (true) {
+		Frame* frame;
+		{
+			unique_lock<mutex> guard(lock);
+			wake.wait(guard, [this]() { return stopping || !queued.empty(); });
+
+			//the queue is drained before stopping so no captured frame is lost
+			if (queued.empty()) {
+				return;
+			}
+			frame = queued.front();
+			queued.pop_front();
+		}
+
+		Uint64 start = SDL_GetPerformanceCounter();
+
+		char number[16];
+		SDL_snprintf(number, sizeof(number), "%06d", frame->number);
+		string path = prefix + number + (format == CAPTURE_PNG ? ".png" : ".raw");
+		bool written;
+
+		if (format == CAPTURE_PNG) {
+			SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(frame->pixels.data(), frame->w, frame->h, 32,
+				frame->w * static_cast<int>(sizeof(Uint32)), SDL_PIXELFORMAT_ARGB8888);
+			written = surface != nullptr && IMG_SavePNG(surface, path.c_str()) == 0;
+			SDL_FreeSurface(surface);
+		}
+		else {
+			ofstream file(path, ios::binary);
+			file.write(reinterpret_cast<const char*>(frame->pixels.data()), frame->pixels.size() * sizeof(Uint32));
+			written = file.good();
+		}
+
+		Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+		{
+			lock_guard<mutex> guard(lock);
+			encodeTicks += elapsed;
+			stats.written += written ? 1 : 0;
+			freeFrames.push_back(frame);
+		}
+
+		if (!written) {
+			cerr << "could not write " << path << endl;
+		}
+	}
+}
+
+//adds the pixels of a line as horizontal runs (for mostly horizontal lines) or vertical runs
+static void AppendLineRuns(vector<SDL_Rect>& runs, SDL_Point from, SDL_Point to)
+{
+	//the same stepping as the software renderer's lines
+	int dx = abs(to.x - from.x), dy = -abs(to.y - from.y);
+	int sx = from.x < to.x ? 1 : -1, sy = from.y < to.y ? 1 : -1;
+	bool horizontal = dx >= -dy;
+	int err = dx + dy;
+	int x = from.x, y = from.y;
+	int runX = x, runY = y;
+
+	auto close = [&runs](int x0, int y0, int x1, int y1) {
+		runs.push_back({ min(x0, x1), min(y0, y1), abs(x1 - x0) + 1, abs(y1 - y0) + 1 });
+	};
+
+	while (x != to.x || y != to.y) {
+		int e2 = 2 * err;
+		int nx = x, ny = y;
+
+		if (e2 >= dy) { err += dy; nx += sx; }
+		if (e2 <= dx) { err += dx; ny += sy; }
+
+		//a step along the minor axis ends the current run
+		if (horizontal ? ny != y : nx != x) {
+			close(runX, runY, x, y);
+			runX = nx;
+			runY = ny;
+		}
+		x = nx;
+		y = ny;
+	}
+	close(runX, runY, x, y);
+}
+
+void GFW::Render::DebugBatch::Add(const Vector2D* v, int count, SDL_Color color, const Camera* camera)
+{
+	if (count <= 0) {
+		return;
+	}
+
+	Batch* batch = nullptr;
+	for (Batch& b : batches) {
+		if (b.color.r == color.r && b.color.g == color.g && b.color.b == color.b && b.color.a == color.a) {
+			batch = &b;
+			break;
+		}
+	}
+	if (batch == nullptr) {
+		batches.push_back({ color, vector<SDL_Rect>() });
+		batch = &batches.back();
+	}
+
+	bool transform = camera != nullptr && !camera->IsIdentity();
+	Vector2D previous = transform ? camera->WorldToScreen(v[0]) : v[0];
+
+	if (count == 1) {
+		AppendLineRuns(batch->runs, { previous.x, previous.y }, { previous.x, previous.y });
+	}
+	for (int i = 1; i < count; i++) {
+		Vector2D next = transform ? camera->WorldToScreen(v[i]) : v[i];
+		AppendLineRuns(batch->runs, { previous.x, previous.y }, { next.x, next.y });
+		previous = next;
+	}
+
+	//the closing edge, like Points::Draw (two points already are a single edge)
+	if (count > 2) {
+		Vector2D first = transform ? camera->WorldToScreen(v[0]) : v[0];
+		AppendLineRuns(batch->runs, { previous.x, previous.y }, { first.x, first.y });
+	}
+
+	stats.outlines++;
+}
+
+void GFW::Render::DebugBatch::Flush(SDL_Renderer* renderer)
+{
+	for (Batch& batch : batches) {
+		if (batch.runs.empty()) {
+			continue;
+		}
+
+		GFW_SetRenderDrawColor(renderer, batch.color);
+		SDL_RenderFillRects(renderer, batch.runs.data(), static_cast<int>(batch.runs.size()));
+
+		stats.runs += static_cast<int>(batch.runs.size());
+		stats.drawCalls++;
+		batch.runs.clear();
+	}
+
+	lastStats = stats;
+	stats = DebugBatchStats();
+}
+
+//the four channels of a pixel in 16 bit lanes, so sums and weighted sums of several pixels fit in one 64 bit add
+static inline Uint64 SpreadChannels(Uint32 p)
+{
+	return (p & 0xFF) | static_cast<Uint64>((p >> 8) & 0xFF) << 16 | static_cast<Uint64>((p >> 16) & 0xFF) << 32 | static_cast<Uint64>(p >> 24) << 48;
+}
+
+//the lanes shifted down by 8 bits, with rounding
+static inline Uint32 PackChannels8(Uint64 lanes)
+{
+	lanes = (lanes + 0x0080008000800080ULL) >> 8;
+	return static_cast<Uint32>((lanes & 0xFF) | ((lanes >> 16) & 0xFF) << 8 | ((lanes >> 32) & 0xFF) << 16 | ((lanes >> 48) & 0xFF) << 24);
+}
+
+//the lanes multiplied by a 8.24 fixed point reciprocal, with rounding
+static inline Uint32 PackChannelsScaled(Uint64 lanes, Uint64 reciprocal)
+{
+#ifdef GFW_SSE2
+	//the products need up to 40 bits, so lanes 0 and 2 and then lanes 1 and 3 are multiplied into 64 bit halves
+	const __m128i zero = _mm_setzero_si128();
+	__m128i values = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&lanes)), zero);
+	__m128i factor = _mm_set1_epi32(static_cast<int>(reciprocal));
+	__m128i round = _mm_set1_epi64x(1 << 23);
+
+	__m128i even = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(values, factor), round), 24);
+	__m128i odd = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(values, 32), factor), round), 24);
+	__m128i scaled = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 2, 0)));
+
+	//saturating to 16 and then 8 bits clamps each lane to 255
+	return static_cast<Uint32>(_mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(scaled, zero), zero)));
+#else
+	Uint32 result = 0;
+	for (int lane = 0; lane < 4; lane++) {
+		Uint64 value = (((lanes >> (16 * lane)) & 0xFFFF) * reciprocal + (1 << 23)) >> 24;
+		result |= static_cast<Uint32>(min<Uint64>(value, 255)) << (8 * lane);
+	}
+	return result;
+#endif
+}
+
+void GFW::Render::BoxBlur::Apply(int pass, const Uint32* src, Uint32* dst, int w, int h, int y0, int y1)
+{
+	int size = 2 * radius + 1;
+	Uint64 reciprocal = ((1ULL << 24) + size / 2) / size;
+
+	if (pass == 0) {
+		//a running sum along each row, edge pixels repeat past the border
+		for (int y = y0; y < y1; y++) {
+			const Uint32* in = src + static_cast<size_t>(y) * w;
+			Uint32* out = dst + static_cast<size_t>(y) * w;
+			Uint64 sum = 0;
+
+			for (int i = -radius; i <= radius; i++) {
+				sum += SpreadChannels(in[max(0, min(i, w - 1))]);
+			}
+			for (int x = 0; x < w; x++) {
+				out[x] = PackChannelsScaled(sum, reciprocal);
+				sum += SpreadChannels(in[min(x + radius + 1, w - 1)]);
+				sum -= SpreadChannels(in[max(x - radius, 0)]);
+			}
+		}
+		return;
+	}
+
+	//a running sum down each column of this band of rows
+	vector<Uint64> sums(w, 0);
+
+	for (int i = y0 - radius; i <= y0 + radius; i++) {
+		const Uint32* in = src + static_cast<size_t>(max(0, min(i, h - 1))) * w;
+		for (int x = 0; x < w; x++) {
+			sums[x] += SpreadChannels(in[x]);
+		}
+	}
+	for (int y = y0; y < y1; y++) {
+		Uint32* out = dst + static_cast<size_t>(y) * w;
+		const Uint32* entering = src + static_cast<size_t>(min(y + radius + 1, h - 1)) * w;
+		const Uint32* leaving = src + static_cast<size_t>(max(y - radius, 0)) * w;
+
+		for (int x = 0; x < w; x++) {
+			out[x] = PackChannelsScaled(sums[x], reciprocal);
+			sums[x] += SpreadChannels(entering[x]);
+			sums[x] -= SpreadChannels(leaving[x]);
+		}
+	}
+}
+
+GFW::Render::GaussianBlur::GaussianBlur(double sigma)
+{
+	sigma = max(sigma, 0.1);
+	radius = min(64, static_cast<int>(ceil(3 * sigma)));
+
+	vector<double> exact(2 * radius + 1);
+	double total = 0;
+	for (int i = -radius; i <= radius; i++) {
+		exact[i + radius] = exp(-(i * i) / (2 * sigma * sigma));
+		total += exact[i + radius];
+	}
+
+	//integer weights which add up to exactly 256, so a weighted sum of 8 bit channels fits in a 16 bit lane
+	weights.resize(exact.size());
+	Uint32 sum = 0;
+	for (size_t i = 0; i < exact.size(); i++) {
+		weights[i] = static_cast<Uint32>(lround(exact[i] / total * 256));
+		sum += weights[i];
+	}
+	weights[radius] += 256 - sum;
+}
+
+void GFW::Render::GaussianBlur::Apply(int pass, const Uint32* src, Uint32* dst, int w, int h, int y0, int y1)
+{
+	for (int y = y0; y < y1; y++) {
+		Uint32* out = dst + static_cast<size_t>(y) * w;
+
+		if (pass == 0) {
+			const Uint32* in = src + static_cast<size_t>(y) * w;
+
+			for (int x = 0; x < w; x++) {
+				Uint64 sum = 0;
+				for (int i = -radius; i <= radius; i++) {
+					sum += SpreadChannels(in[max(0, min(x + i, w - 1))]) * weights[i + radius];
+				}
+				out[x] = PackChannels8(sum);
+			}
+		}
+		else {
+			for (int x = 0; x < w; x++) {
+				Uint64 sum = 0;
+				for (int i = -radius; i <= radius; i++) {
+					sum += SpreadChannels(src[static_cast<size_t>(max(0, min(y + i, h - 1))) * w + x]) * weights[i + radius];
+				}
+				out[x] = PackChannels8(sum);
+			}
+		}
+	}
+}
+
+GFW::Render::ColorGrade::ColorGrade()
+{
+	for (int channel = 0; channel < 3; channel++) {
+		for (int i = 0; i < 256; i++) {
+			lut[channel][i] = static_cast<Uint8>(i);
+		}
+	}
+}
+
+void GFW::Render::ColorGrade::SetCurve(int channel, function<double(double)> curve)
+{
+	for (int c = 0; c < 3; c++) {
+		if (channel != -1 && channel != c) {
+			continue;
+		}
+		for (int i = 0; i < 256; i++) {
+			lut[c][i] = static_cast<Uint8>(lround(max(0.0, min(1.0, curve(i / 255.0))) * 255));
+		}
+	}
+}
+
+void GFW::Render::ColorGrade::Apply(int pass, const Uint32* src, Uint32* dst, int w, int h, int y0, int y1)
+{
+	for (size_t i = static_cast<size_t>(y0) * w; i < static_cast<size_t>(y1) * w; i++) {
+		Uint32 p = src[i];
+		dst[i] = (p & 0xFF000000) | lut[0][(p >> 16) & 0xFF] << 16 | lut[1][(p >> 8) & 0xFF] << 8 | lut[2][p & 0xFF];
+	}
+}
+
+void GFW::Render::Vignette::Prepare(int w, int h)
+{
+	if (w == maskW && h == maskH) {
+		return;
+	}
+
+	mask.resize(static_cast<size_t>(w) * h);
+	maskW = w;
+	maskH = h;
+
+	double cx = w / 2.0, cy = h / 2.0;
+	double corner = sqrt(cx * cx + cy * cy);
+
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			double d = sqrt((x + 0.5 - cx) * (x + 0.5 - cx) + (y + 0.5 - cy) * (y + 0.5 - cy)) / corner;
+			double t = max(0.0, min(1.0, (d - start) / max(1 - start, 0.001)));
+			//smoothstep, so the darkening fades in without a visible edge
+			double darkening = strength * t * t * (3 - 2 * t);
+			mask[static_cast<size_t>(y) * w + x] = static_cast<Uint16>(lround((1 - darkening) * 256));
+		}
+	}
+}
+
+void GFW::Render::Vignette::Apply(int pass, const Uint32* src, Uint32* dst, int w, int h, int y0, int y1)
+{
+	for (size_t i = static_cast<size_t>(y0) * w; i < static_cast<size_t>(y1) * w; i++) {
+		Uint32 p = src[i], f = mask[i];
+		//red and blue are scaled in one multiply
+		Uint32 rb = (((p & 0x00FF00FF) * f) >> 8) & 0x00FF00FF;
+		Uint32 g = (((p & 0x0000FF00) * f) >> 8) & 0x0000FF00;
+		dst[i] = (p & 0xFF000000) | rb | g;
+	}
+}
+
+void GFW::Render::PostProcess::Remove(PostFilter& f)
+{
+	filters.erase(remove(filters.begin(), filters.end(), &f), filters.end());
+}
+
+void GFW::Render::PostProcess::Apply(SDL_Renderer* renderer, int w, int h)
+{
+	double msPerTick = 1000.0 / SDL_GetPerformanceFrequency();
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	front.resize(static_cast<size_t>(w) * h);
+	back.resize(front.size());
+
+	if (SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, front.data(), w * static_cast<int>(sizeof(Uint32))) != 0) {
+		cerr << "error: " << SDL_GetError() << endl;
+		return;
+	}
+
+	stats.readMs = (SDL_GetPerformanceCounter() - start) * msPerTick;
+	stats.filters.clear();
+	stats.threads = pool->GetThreads();
+
+	//a few bands per thread so uneven rows even out
+	int bandRows = max(1, h / (stats.threads * 4));
+	int bands = (h + bandRows - 1) / bandRows;
+
+	for (PostFilter* f : filters) {
+		start = SDL_GetPerformanceCounter();
+		f->Prepare(w, h);
+
+		for (int p = 0; p < f->GetPasses(); p++) {
+			const Uint32* src = front.data();
+			Uint32* dst = back.data();
+
+			pool->Run(bands, [f, p, src, dst, w, h, bandRows](int band) {
+				f->Apply(p, src, dst, w, h, band * bandRows, min(h, (band + 1) * bandRows));
+			});
+			front.swap(back);
+		}
+
+		stats.filters.push_back({ f->GetName(), (SDL_GetPerformanceCounter() - start) * msPerTick });
+	}
+
+	start = SDL_GetPerformanceCounter();
+
+	if (upload == nullptr || uploadW != w || uploadH != h) {
+		Destroy();
+		upload = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+
+		if (upload == nullptr) {
+			cerr << "error: " << SDL_GetError() << endl;
+			return;
+		}
+		SDL_SetTextureBlendMode(upload, SDL_BLENDMODE_NONE);
+		uploadW = w;
+		uploadH = h;
+	}
+
+	SDL_UpdateTexture(upload, NULL, front.data(), w * static_cast<int>(sizeof(Uint32)));
+	SDL_RenderCopy(renderer, upload, NULL, NULL);
+
+	stats.uploadMs = (SDL_GetPerformanceCounter() - start) * msPerTick;
+}
+
+void GFW::Render::PostProcess::Destroy()
+{
+	if (upload != nullptr) {
+		SDL_DestroyTexture(upload);
+		upload = nullptr;
+	}
+}
+
+GFW::Canvas::Canvas GFW::Canvas::CreateCanvas(int w, int h, SDL_Renderer* renderer)
+{
+	Canvas canvas;
+	canvas.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+
+	if (canvas.texture == nullptr) {
+		cerr << "error: " << SDL_GetError() << endl;
+		return canvas;
+	}
+
+	SDL_SetTextureBlendMode(canvas.texture, SDL_BLENDMODE_BLEND);
+	canvas.pixels.assign(static_cast<size_t>(w) * h, 0);
+	canvas.w = w;
+	canvas.h = h;
+	canvas.rect = { 0, 0, w, h };
+	canvas.MarkDirty(0, h);
+
+	return canvas;
+}
+
+void GFW::Canvas::Canvas::MarkDirty(int y0, int y1)
+{
+	y0 = max(y0, 0);
+	y1 = min(y1, h);
+
+	if (y0 >= y1) {
+		return;
+	}
+
+	if (dirtyTop >= dirtyBottom) {
+		dirtyTop = y0;
+		dirtyBottom = y1;
+	}
+	else {
+		dirtyTop = min(dirtyTop, y0);
+		dirtyBottom = max(dirtyBottom, y1);
+	}
+	RequestUpdate();
+}
+
+void GFW::Canvas::Canvas::Fill(const SDL_Rect& area, SDL_Color color)
+{
+	SDL_Rect bounds = { 0, 0, w, h }, clip;
+
+	if (!SDL_IntersectRect(&area, &bounds, &clip)) {
+		return;
+	}
+
+	Uint32 pixel = MapColor(color);
+	for (int y = clip.y; y < clip.y + clip.h; y++) {
+		fill(GetRow(y) + clip.x, GetRow(y) + clip.x + clip.w, pixel);
+	}
+	MarkDirty(clip.y, clip.y + clip.h);
+}
+
+void GFW::Canvas::Canvas::Blend(const SDL_Rect& area, SDL_Color color)
+{
+	SDL_Rect bounds = { 0, 0, w, h }, clip;
+
+	if (!SDL_IntersectRect(&area, &bounds, &clip)) {
+		return;
+	}
+
+	Uint32 pixel = MapColor(color);
+	for (int y = clip.y; y < clip.y + clip.h; y++) {
+		Uint32* row = GetRow(y) + clip.x;
+		for (int i = 0; i < clip.w; i++) {
+			row[i] = BlendOver(pixel, row[i]);
+		}
+	}
+	MarkDirty(clip.y, clip.y + clip.h);
+}
+
+void GFW::Canvas::Canvas::SetPixel(int x, int y, SDL_Color color)
+{
+	if (x >= 0 && y >= 0 && x < w && y < h) {
+		GetRow(y)[x] = MapColor(color);
+		MarkDirty(y, y + 1);
+	}
+}
+
+void GFW::Canvas::Canvas::BlendPixel(int x, int y, SDL_Color color)
+{
+	if (x >= 0 && y >= 0 && x < w && y < h) {
+		GetRow(y)[x] = BlendOver(MapColor(color), GetRow(y)[x]);
+		MarkDirty(y, y + 1);
+	}
+}
+
+void GFW::Canvas::Canvas::Blit(const Uint32* src, int srcW, int srcH, int x, int y, bool blend)
+{
+	SDL_Rect bounds = { 0, 0, w, h }, area = { x, y, srcW, srcH }, clip;
+
+	if (!SDL_IntersectRect(&area, &bounds, &clip)) {
+		return;
+	}
+
+	for (int row = clip.y; row < clip.y + clip.h; row++) {
+		const Uint32* from = src + static_cast<size_t>(row - y) * srcW + (clip.x - x);
+		Uint32* to = GetRow(row) + clip.x;
+
+		if (blend) {
+			for (int i = 0; i < clip.w; i++) {
+				to[i] = BlendOver(from[i], to[i]);
+			}
+		}
+		else {
+			copy(from, from + clip.w, to);
+		}
+	}
+	MarkDirty(clip.y, clip.y + clip.h);
+}
+
+void GFW::Canvas::Canvas::Draw(SDL_Renderer* renderer)
+{
+	SDL_RenderCopy(renderer, texture, NULL, &rect);
+}
+
+void GFW::Canvas::Canvas::DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera)
+{
+	if (camera.IsIdentity()) {
+		Draw(renderer);
+		return;
+	}
+
+	double angle = 0;
+	SDL_Rect dst = CameraRect(camera, rect, angle);
+	SDL_RenderCopyEx(renderer, texture, NULL, &dst, angle, NULL, SDL_FLIP_NONE);
+}
+
+bool GFW::Canvas::Canvas::Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera)
+{
+	double angle = 0;
+	SDL_Rect dst = camera.IsIdentity() ? rect : CameraRect(camera, rect, angle);
+	return target.CopyEx(texture, NULL, dst, angle);
+}
+
+void GFW::Canvas::Canvas::Destroy()
+{
+	if (texture != nullptr) {
+		Render::SoftwareRenderer::ReleaseTexture(texture);
+		SDL_DestroyTexture(texture);
+		texture = nullptr;
+	}
+}
+
+void GFW::Canvas::Canvas::DoUpdate(SDL_Renderer* renderer)
+{
+	if (texture == nullptr || dirtyTop >= dirtyBottom) {
+		return;
+	}
+
+	SDL_Rect rows = { 0, dirtyTop, w, dirtyBottom - dirtyTop };
+	SDL_UpdateTexture(texture, &rows, GetRow(dirtyTop), w * static_cast<int>(sizeof(Uint32)));
+
+	//the software renderer samples its own copy, which is refreshed whole
+	if (Render::SoftwareRenderer::Find(renderer) != nullptr) {
+		SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(pixels.data(), w, h, 32, w * static_cast<int>(sizeof(Uint32)), SDL_PIXELFORMAT_ARGB8888);
+		Render::SoftwareRenderer::CaptureTexture(renderer, texture, surface);
+		SDL_FreeSurface(surface);
+	}
+
+	dirtyTop = dirtyBottom = 0;
+}
+
+void GFW::Tilemap::Tilemap::SetTileset(SDL_Texture* texture, int columns)
+{
+	tileset = texture;
+	tilesetColumns = max(1, columns);
+
+	for (auto& entry : chunks) {
+		entry.second.dirty = true;
+	}
+	version++;
+}
+
+void GFW::Tilemap::Tilemap::SetTileSolid(Uint16 id, bool solid)
+{
+	if (solidIds.size() <= id) {
+		solidIds.resize(id + 1, false);
+	}
+	solidIds[id] = solid;
+}
+
+GFW::Tilemap::Tilemap::Chunk* GFW::Tilemap::Tilemap::FindChunk(int tx, int ty, int& index)
+{
+	int cx = FloorDiv(tx, chunkTiles), cy = FloorDiv(ty, chunkTiles);
+	auto found = chunks.find(ChunkKey(cx, cy));
+
+	if (found == chunks.end()) {
+		return nullptr;
+	}
+
+	index = (ty - cy * chunkTiles) * chunkTiles + (tx - cx * chunkTiles);
+	return &found->second;
+}
+
+GFW::Tilemap::Tilemap::Chunk& GFW::Tilemap::Tilemap::GetChunk(int tx, int ty, int& index)
+{
+	int cx = FloorDiv(tx, chunkTiles), cy = FloorDiv(ty, chunkTiles);
+	Chunk& chunk = chunks[ChunkKey(cx, cy)];
+
+	if (chunk.tiles.empty()) {
+		chunk.tiles.assign(chunkTiles * chunkTiles, 0);
+		chunk.solid.assign((chunkTiles * chunkTiles + 31) / 32, 0);
+	}
+
+	index = (ty - cy * chunkTiles) * chunkTiles + (tx - cx * chunkTiles);
+	return chunk;
+}
+
+void GFW::Tilemap::Tilemap::SetTile(int tx, int ty, Uint16 id)
+{
+	int index;
+	Chunk& chunk = GetChunk(tx, ty, index);
+
+	chunk.tiles[index] = id;
+	chunk.dirty = true;
+	version++;
+
+	SetSolid(tx, ty, id < solidIds.size() && solidIds[id]);
+}
+
+Uint16 GFW::Tilemap::Tilemap::GetTile(int tx, int ty)
+{
+	int index;
+	Chunk* chunk = FindChunk(tx, ty, index);
+	return chunk != nullptr ? chunk->tiles[index] : 0;
+}
+
+void GFW::Tilemap::Tilemap::SetSolid(int tx, int ty, bool solid)
+{
+	int index;
+	Chunk& chunk = GetChunk(tx, ty, index);
+
+	if (solid) {
+		chunk.solid[index / 32] |= 1u << (index % 32);
+	}
+	else {
+		chunk.solid[index / 32] &= ~(1u << (index % 32));
+	}
+}
+
+bool GFW::Tilemap::Tilemap::IsSolid(int tx, int ty)
+{
+	int index;
+	Chunk* chunk = FindChunk(tx, ty, index);
+	return chunk != nullptr && (chunk->solid[index / 32] >> (index % 32) & 1) != 0;
+}
+
+bool GFW::Tilemap::Tilemap::Overlaps(const SDL_Rect& area)
+{
+	if (area.w <= 0 || area.h <= 0) {
+		return false;
+	}
+
+	for (int ty = FloorDiv(area.y, tileH); ty <= FloorDiv(area.y + area.h - 1, tileH); ty++) {
+		for (int tx = FloorDiv(area.x, tileW); tx <= FloorDiv(area.x + area.w - 1, tileW); tx++) {
+			if (IsSolid(tx, ty)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool GFW::Tilemap::Tilemap::GetDrawRect(SDL_Rect& rect)
+{
+	if (chunks.empty()) {
+		return false;
+	}
+
+	int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+	for (auto& entry : chunks) {
+		int cx = static_cast<int>(entry.first >> 32), cy = static_cast<Sint32>(entry.first & 0xFFFFFFFF);
+		minX = min(minX, cx);
+		minY = min(minY, cy);
+		maxX = max(maxX, cx);
+		maxY = max(maxY, cy);
+	}
+
+	rect = { minX * chunkTiles * tileW, minY * chunkTiles * tileH, (maxX - minX + 1) * chunkTiles * tileW, (maxY - minY + 1) * chunkTiles * tileH };
+	return true;
+}
+
+void GFW::Tilemap::Tilemap::RenderChunk(SDL_Renderer* renderer, Chunk& chunk)
+{
+	int w = chunkTiles * tileW, h = chunkTiles * tileH;
+
+	if (chunk.texture == nullptr) {
+		chunk.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+
+		if (chunk.texture == nullptr) {
+			return;
+		}
+	}
+
+	//tiles don't overlap, so their texels are copied into the cleared texture as they are instead of being blended,
+	//which leaves the chunk in the tileset's own alpha format (straight, or premultiplied if Image made it so)
+	SDL_BlendMode tilesetMode = SDL_BLENDMODE_BLEND;
+	if (tileset != nullptr) {
+		SDL_GetTextureBlendMode(tileset, &tilesetMode);
+		SDL_SetTextureBlendMode(tileset, SDL_BLENDMODE_NONE);
+	}
+	SDL_SetTextureBlendMode(chunk.texture, tilesetMode == Image::PremultipliedBlendMode() ? tilesetMode : SDL_BLENDMODE_BLEND);
+
+	{
+		TargetScope scope(renderer, chunk.texture);
+		scope.Clear({ 0, 0, 0, 0 });
+
+		for (int i = 0; i < chunkTiles * chunkTiles && tileset != nullptr; i++) {
+			Uint16 id = chunk.tiles[i];
+
+			if (id != 0) {
+				SDL_Rect src = { ((id - 1) % tilesetColumns) * tileW, ((id - 1) / tilesetColumns) * tileH, tileW, tileH };
+				SDL_Rect dst = { (i % chunkTiles) * tileW, (i / chunkTiles) * tileH, tileW, tileH };
+				SDL_RenderCopy(renderer, tileset, &src, &dst);
+			}
+		}
+	}
+
+	if (tileset != nullptr) {
+		SDL_SetTextureBlendMode(tileset, tilesetMode);
+	}
+
+	chunk.dirty = false;
+	renderCount++;
+}
+
+void GFW::Tilemap::Tilemap::DrawView(SDL_Renderer* renderer, const SDL_Rect& view, const Render::Camera* camera)
+{
+	int chunkW = chunkTiles * tileW, chunkH = chunkTiles * tileH;
+
+	//walking the chunks in view, or every chunk when there are fewer of those
+	int minX = FloorDiv(view.x, chunkW), maxX = FloorDiv(view.x + view.w - 1, chunkW);
+	int minY = FloorDiv(view.y, chunkH), maxY = FloorDiv(view.y + view.h - 1, chunkH);
+
+	auto drawChunk = [&](int cx, int cy, Chunk& chunk) {
+		if (chunk.dirty || chunk.texture == nullptr) {
+			RenderChunk(renderer, chunk);
+		}
+
+		SDL_Rect dst = { cx * chunkW, cy * chunkH, chunkW, chunkH };
+		if (camera != nullptr && !camera->IsIdentity()) {
+			//the edges are rounded rather than the position and size, so neighbouring chunks share them at any zoom,
+			//and every chunk is turned around the same point (the view's center) so they stay joined when rotated
+			SDL_Rect vp = camera->GetViewport();
+			double centerX = vp.x + vp.w / 2.0, centerY = vp.y + vp.h / 2.0;
+			auto edgeX = [&](int wx) { return static_cast<int>(lround(centerX + camera->zoom * (wx - (camera->x + vp.w / 2.0)))); };
+			auto edgeY = [&](int wy) { return static_cast<int>(lround(centerY + camera->zoom * (wy - (camera->y + vp.h / 2.0)))); };
+
+			int x0 = edgeX(cx * chunkW), x1 = edgeX((cx + 1) * chunkW);
+			int y0 = edgeY(cy * chunkH), y1 = edgeY((cy + 1) * chunkH);
+			dst = { x0, y0, x1 - x0, y1 - y0 };
+
+			SDL_Point pivot = { static_cast<int>(lround(centerX)) - x0, static_cast<int>(lround(centerY)) - y0 };
+			SDL_RenderCopyEx(renderer, chunk.texture, NULL, &dst, -camera->rotation, &pivot, SDL_FLIP_NONE);
+		}
+		else {
+			SDL_RenderCopy(renderer, chunk.texture, NULL, &dst);
+		}
+	};
+
+	if (static_cast<Sint64>(maxX - minX + 1) * (maxY - minY + 1) > static_cast<Sint64>(chunks.size())) {
+		for (auto& entry : chunks) {
+			int cx = static_cast<int>(entry.first >> 32), cy = static_cast<Sint32>(entry.first & 0xFFFFFFFF);
+			if (cx >= minX && cx <= maxX && cy >= minY && cy <= maxY) {
+				drawChunk(cx, cy, entry.second);
+			}
+		}
+	}
+	else {
+		for (int cy = minY; cy <= maxY; cy++) {
+			for (int cx = minX; cx <= maxX; cx++) {
+				auto found = chunks.find(ChunkKey(cx, cy));
+				if (found != chunks.end()) {
+					drawChunk(cx, cy, found->second);
+				}
+			}
+		}
+	}
+}
+
+void GFW::Tilemap::Tilemap::Draw(SDL_Renderer* renderer)
+{
+	SDL_Rect view = { 0, 0, 0, 0 };
+	SDL_GetRendererOutputSize(renderer, &view.w, &view.h);
+	DrawView(renderer, view, nullptr);
+}
+
+void GFW::Tilemap::Tilemap::DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera)
+{
+	DrawView(renderer, camera.GetViewBounds(), &camera);
+}
+
+bool GFW::Tilemap::Tilemap::Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera)
+{
+	//chunk textures only live on the GPU, so the tiles are copied one by one from the captured tileset
+	SDL_Rect view = camera.GetViewBounds();
+
+	for (int ty = FloorDiv(view.y, tileH); ty <= FloorDiv(view.y + view.h - 1, tileH); ty++) {
+		for (int tx = FloorDiv(view.x, tileW); tx <= FloorDiv(view.x + view.w - 1, tileW); tx++) {
+			Uint16 id = GetTile(tx, ty);
+
+			if (id != 0) {
+				SDL_Rect src = { ((id - 1) % tilesetColumns) * tileW, ((id - 1) / tilesetColumns) * tileH, tileW, tileH };
+				SDL_Rect dst = { tx * tileW, ty * tileH, tileW, tileH };
+				double angle = 0;
+
+				if (!camera.IsIdentity()) {
+					dst = CameraRect(camera, dst, angle);
+				}
+				if (!target.CopyEx(tileset, &src, dst, angle)) {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void GFW::Tilemap::Tilemap::Destroy()
+{
+	for (auto& entry : chunks) {
+		if (entry.second.texture != nullptr) {
+			SDL_DestroyTexture(entry.second.texture);
+			entry.second.texture = nullptr;
+		}
+		entry.second.dirty = true;
+	}
+}
+
+GFW::Particles::ParticleSystem::ParticleSystem(int capacity)
+	: capacity(capacity), x(capacity), y(capacity), vx(capacity), vy(capacity), age(capacity), lifetime(capacity), color(capacity)
+{
+}
+
+bool GFW::Particles::ParticleSystem::Emit(const Particle& particle)
+{
+	if (count == capacity) {
+		return false;
+	}
+
+	x[count] = particle.x;
+	y[count] = particle.y;
+	vx[count] = particle.vx;
+	vy[count] = particle.vy;
+	age[count] = 0;
+	//a particle with no lifetime still lives until the next Advance, and fading divides by its lifetime before then
+	lifetime[count] = particle.lifetime > 0 ? particle.lifetime : FLT_MIN;
+	color[count] = particle.color;
+	count++;
+	return true;
+}
+
+void GFW::Particles::ParticleSystem::Kill(int index)
+{
+	count--;
+	x[index] = x[count];
+	y[index] = y[count];
+	vx[index] = vx[count];
+	vy[index] = vy[count];
+	age[index] = age[count];
+	lifetime[index] = lifetime[count];
+	color[index] = color[count];
+}
+
+void GFW::Particles::ParticleSystem::Integrate(int begin, int end, float dt)
+{
+	//separate arrays and no branches, so four particles fit in each SSE2 register (the loop finishes the rest, and
+	//everything without SSE2, where the compiler may still vectorize it)
+	float* px = x.data();
+	float* py = y.data();
+	float* pvx = vx.data();
+	float* pvy = vy.data();
+	float* page = age.data();
+	float ax = gravityX * dt, ay = gravityY * dt;
+	int i = begin;
+
+#ifdef GFW_SSE2
+	__m128 vax = _mm_set1_ps(ax), vay = _mm_set1_ps(ay), vdt = _mm_set1_ps(dt);
+
+	for (; i + 4 <= end; i += 4) {
+		__m128 nvx = _mm_add_ps(_mm_loadu_ps(pvx + i), vax);
+		__m128 nvy = _mm_add_ps(_mm_loadu_ps(pvy + i), vay);
+		_mm_storeu_ps(pvx + i, nvx);
+		_mm_storeu_ps(pvy + i, nvy);
+		_mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(nvx, vdt)));
+		_mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(nvy, vdt)));
+		_mm_storeu_ps(page + i, _mm_add_ps(_mm_loadu_ps(page + i), vdt));
+	}
+#endif
+
+	for (; i < end; i++) {
+		pvx[i] += ax;
+		pvy[i] += ay;
+		px[i] += pvx[i] * dt;
+		py[i] += pvy[i] * dt;
+		page[i] += dt;
+	}
+}
+
+void GFW::Particles::ParticleSystem::Advance(float dt, int threads)
+{
+	//below this many particles per thread starting a thread costs more than it saves
+	const int minChunk = 16384;
+
+	Render::WorkerPool& pool = Render::WorkerPool::Shared();
+
+	if (threads <= 0) {
+		threads = pool.GetThreads();
+	}
+	int chunks = max(1, min(threads, count / minChunk));
+
+	if (chunks == 1) {
+		Integrate(0, count, dt);
+	}
+	else {
+		int per = (count + chunks - 1) / chunks;
+
+		pool.Run(chunks, [this, per, dt](int chunk) {
+			Integrate(min(count, chunk * per), min(count, (chunk + 1) * per), dt);
+		});
+	}
+
+	for (int i = 0; i < count; ) {
+		if (age[i] >= lifetime[i]) {
+			Kill(i);
+		}
+		else {
+			i++;
+		}
+	}
+
+	float minX = 0, minY = 0, maxX = 0, maxY = 0;
+	if (count > 0) {
+		minX = *min_element(x.begin(), x.begin() + count);
+		maxX = *max_element(x.begin(), x.begin() + count);
+		minY = *min_element(y.begin(), y.begin() + count);
+		maxY = *max_element(y.begin(), y.begin() + count);
+	}
+	bounds = { static_cast<int>(floor(minX)), static_cast<int>(floor(minY)),
+		static_cast<int>(ceil(maxX - floor(minX))) + size, static_cast<int>(ceil(maxY - floor(minY))) + size };
+
+	steps++;
+}
+
+void GFW::Particles::ParticleSystem::FillBuckets(const Render::Camera* camera)
+{
+	//rebuilt every frame so colors which have died out don't keep their buckets, reusing the rect arrays
+	bucketIndex.clear();
+	size_t used = 0;
+
+	bool transform = camera != nullptr && !camera->IsIdentity();
+	int drawSize = transform ? max(1, static_cast<int>(lround(size * camera->zoom))) : size;
+	double half = drawSize / 2.0;
+
+	for (int i = 0; i < count; i++) {
+		SDL_Color c = color[i];
+
+		if (fade) {
+			//quantized to 16 levels so fading particles still share a few batches
+			int level = static_cast<int>(16 * (1 - age[i] / lifetime[i]));
+			c.a = static_cast<Uint8>(c.a * max(0, min(level + 1, 16)) / 16);
+		}
+
+		Uint32 key = static_cast<Uint32>(c.a) << 24 | c.r << 16 | c.g << 8 | c.b;
+		auto found = bucketIndex.find(key);
+		size_t index;
+
+		if (found == bucketIndex.end()) {
+			index = used++;
+			bucketIndex[key] = index;
+
+			if (index == buckets.size()) {
+				buckets.push_back({ c, vector<SDL_Rect>() });
+			}
+			else {
+				buckets[index].color = c;
+				buckets[index].rects.clear();
+			}
+		}
+		else {
+			index = found->second;
+		}
+
+		double sx = x[i], sy = y[i];
+		if (transform) {
+			camera->WorldToScreen(x[i], y[i], sx, sy);
+		}
+		buckets[index].rects.push_back({ static_cast<int>(floor(sx + size / 2.0 - half)), static_cast<int>(floor(sy + size / 2.0 - half)), drawSize, drawSize });
+	}
+
+	buckets.resize(used);
+}
+
+void GFW::Particles::ParticleSystem::DrawBuckets(SDL_Renderer* renderer, double angle)
+{
+	//the alpha mod doesn't scale the colors of a premultiplied texture, so the color mod has to
+	SDL_BlendMode mode = SDL_BLENDMODE_BLEND;
+	if (texture != nullptr) {
+		SDL_GetTextureBlendMode(texture, &mode);
+	}
+	bool premultiplied = mode == Image::PremultipliedBlendMode();
+
+	//the texture may be shared with Images (through TextureCache), so its mods are put back afterwards
+	Uint8 r = 255, g = 255, b = 255, a = 255;
+	if (texture != nullptr) {
+		SDL_GetTextureColorMod(texture, &r, &g, &b);
+		SDL_GetTextureAlphaMod(texture, &a);
+	}
+
+	for (Bucket& bucket : buckets) {
+		if (bucket.rects.empty()) {
+			continue;
+		}
+
+		if (texture == nullptr) {
+			GFW_SetRenderDrawColor(renderer, bucket.color);
+			SDL_RenderFillRects(renderer, bucket.rects.data(), static_cast<int>(bucket.rects.size()));
+			continue;
+		}
+
+		//the copies of one bucket share their texture state, so SDL can batch them
+		SDL_Color c = bucket.color;
+		if (premultiplied) {
+			c = { static_cast<Uint8>(c.r * c.a / 255), static_cast<Uint8>(c.g * c.a / 255), static_cast<Uint8>(c.b * c.a / 255), c.a };
+		}
+		//an opaque texture ignores the alpha mod, so translucent particles blend it like straight alpha
+		if (mode == SDL_BLENDMODE_NONE) {
+			SDL_SetTextureBlendMode(texture, c.a < 255 ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+		}
+		SDL_SetTextureColorMod(texture, c.r, c.g, c.b);
+		SDL_SetTextureAlphaMod(texture, c.a);
+		for (const SDL_Rect& rect : bucket.rects) {
+			if (angle == 0) {
+				SDL_RenderCopy(renderer, texture, NULL, &rect);
+			}
+			else {
+				SDL_RenderCopyEx(renderer, texture, NULL, &rect, angle, NULL, SDL_FLIP_NONE);
+			}
+		}
+	}
+
+	if (texture != nullptr) {
+		SDL_SetTextureBlendMode(texture, mode);
+		SDL_SetTextureColorMod(texture, r, g, b);
+		SDL_SetTextureAlphaMod(texture, a);
+	}
+}
+
+void GFW::Particles::ParticleSystem::Draw(SDL_Renderer* renderer)
+{
+	FillBuckets(nullptr);
+	DrawBuckets(renderer, 0);
 }
 
-GFW::Points::Points::Points(const SDL_Rect& rect)
+void GFW::Particles::ParticleSystem::DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera)
 {
-	Points p = GetRectBounds(rect);
-	v = p.v;
-	midp = p.midp;
+	FillBuckets(&camera);
+	DrawBuckets(renderer, -camera.rotation);
 }
 
-GFW::Points::Points::Points(const Vector2D& vec)
+bool GFW::Particles::ParticleSystem::Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera)
 {
-	v.push_back({ vec.x, vec.y});
-	v.push_back({ vec.x + 1, vec.y });
-	v.push_back({ vec.x + 1, vec.y + 1 });
-	v.push_back({ vec.x, vec.y + 1});
-	midp = v[0];
+	FillBuckets(&camera);
+
+	Uint8 r = 255, g = 255, b = 255, a = 255;
+	if (texture != nullptr) {
+		SDL_GetTextureColorMod(texture, &r, &g, &b);
+		SDL_GetTextureAlphaMod(texture, &a);
+	}
+
+	bool result = true;
+	for (size_t i = 0; i < buckets.size() && result; i++) {
+		Bucket& bucket = buckets[i];
+
+		if (texture == nullptr) {
+			target.FillRects(bucket.rects.data(), static_cast<int>(bucket.rects.size()), bucket.color);
+			continue;
+		}
+
+		//CopyEx records the texture mods as they are when it is called
+		SDL_SetTextureColorMod(texture, bucket.color.r, bucket.color.g, bucket.color.b);
+		SDL_SetTextureAlphaMod(texture, bucket.color.a);
+		for (size_t j = 0; j < bucket.rects.size() && result; j++) {
+			result = target.CopyEx(texture, NULL, bucket.rects[j], -camera.rotation);
+		}
+	}
+
+	//like DrawBuckets, the texture's own mods are put back for whoever else draws it
+	if (texture != nullptr) {
+		SDL_SetTextureColorMod(texture, r, g, b);
+		SDL_SetTextureAlphaMod(texture, a);
+	}
+	return result;
 }
 
-GFW::Points::Points& GFW::Points::Points::operator=(const SDL_Rect& rect)
+namespace {
+	struct SweepEvent {
+		double angle;
+		int wall;
+		bool start;
+	};
+}
+
+void GFW::Lighting::ComputeVisibility(Vector2D origin, int radius, const vector<Vector2D>& walls, vector<Vector2D>& polygon)
 {
-	Points p = GetRectBounds(rect);
-	v = p.v;
-	midp = p.midp;
-	return *this;
+	//the rays cast just past each end, and how much further each wall is kept open so those rays always see it
+	const double nudge = 1e-4, slack = 2e-4, pi2 = M_PI * 2;
+
+	static vector<double> segments;
+	static vector<double> rays;
+	static vector<SweepEvent> events;
+	static vector<int> active, position;
+
+	polygon.clear();
+	segments.clear();
+	rays.clear();
+	events.clear();
+	active.clear();
+
+	auto addWall = [](double x0, double y0, double x1, double y1) {
+		segments.insert(segments.end(), { x0, y0, x1, y1 });
+	};
+
+	//the square around the origin bounds the view, so every ray hits something
+	double r = radius;
+	addWall(-r, -r, r, -r);
+	addWall(r, -r, r, r);
+	addWall(r, r, -r, r);
+	addWall(-r, r, -r, -r);
+
+	for (size_t i = 0; i + 1 < walls.size(); i += 2) {
+		addWall(walls[i].x - origin.x, walls[i].y - origin.y, walls[i + 1].x - origin.x, walls[i + 1].y - origin.y);
+	}
+
+	int count = static_cast<int>(segments.size() / 4);
+	position.assign(count, -1);
+
+	auto open = [](int wall) {
+		if (position[wall] < 0) {
+			position[wall] = static_cast<int>(active.size());
+			active.push_back(wall);
+		}
+	};
+	auto close = [](int wall) {
+		if (position[wall] >= 0) {
+			active[position[wall]] = active.back();
+			position[active.back()] = position[wall];
+			active.pop_back();
+			position[wall] = -1;
+		}
+	};
+	auto wrap = [pi2](double angle) {
+		return angle < -M_PI ? angle + pi2 : angle >= M_PI ? angle - pi2 : angle;
+	};
+
+	for (int i = 0; i < count; i++) {
+		double* s = &segments[i * 4];
+		double cross = s[0] * s[3] - s[1] * s[2];
+
+		//a wall seen edge-on (or through the origin) hides nothing
+		if (cross == 0) {
+			continue;
+		}
+
+		//each wall is swept from the end with the smaller angle, going counter-clockwise in y-up terms
+		if (cross < 0) {
+			swap(s[0], s[2]);
+			swap(s[1], s[3]);
+		}
+
+		double a = atan2(s[1], s[0]), b = atan2(s[3], s[2]);
+		double span = b - a < 0 ? b - a + pi2 : b - a;
+		double start = wrap(a - slack), end = start + span + slack * 2;
+
+		for (double corner : { a, b }) {
+			rays.insert(rays.end(), { wrap(corner - nudge), wrap(corner), wrap(corner + nudge) });
+		}
+
+		if (end >= M_PI) {
+			open(i);
+			events.push_back({ end - pi2, i, false });
+		}
+		events.push_back({ start, i, true });
+		if (end < M_PI) {
+			events.push_back({ end, i, false });
+		}
+	}
+
+	sort(rays.begin(), rays.end());
+	sort(events.begin(), events.end(), [](const SweepEvent& a, const SweepEvent& b) { return a.angle != b.angle ? a.angle < b.angle : a.start > b.start; });
+
+	size_t next = 0;
+	for (size_t i = 0; i < rays.size(); i++) {
+		double angle = rays[i];
+
+		if (i > 0 && angle == rays[i - 1]) {
+			continue;
+		}
+
+		for (; next < events.size() && events[next].angle <= angle; next++) {
+			if (events[next].start) {
+				open(events[next].wall);
+			}
+			else {
+				close(events[next].wall);
+			}
+		}
+
+		double dx = cos(angle), dy = sin(angle), nearest = r * 2;
+
+		for (int wall : active) {
+			const double* s = &segments[wall * 4];
+			double ex = s[2] - s[0], ey = s[3] - s[1];
+			double denom = dx * ey - dy * ex;
+
+			if (denom == 0) {
+				continue;
+			}
+
+			double t = (s[0] * ey - s[1] * ex) / denom;
+			double u = (s[0] * dy - s[1] * dx) / denom;
+
+			if (t >= 0 && t < nearest && u >= -1e-9 && u <= 1 + 1e-9) {
+				nearest = t;
+			}
+		}
+
+		Vector2D hit = { origin.x + static_cast<int>(lround(dx * nearest)), origin.y + static_cast<int>(lround(dy * nearest)) };
+
+		if (polygon.empty() || polygon.back().x != hit.x || polygon.back().y != hit.y) {
+			polygon.push_back(hit);
+		}
+	}
+
+	if (polygon.size() > 1 && polygon.front().x == polygon.back().x && polygon.front().y == polygon.back().y) {
+		polygon.pop_back();
+	}
 }
 
-GFW::Points::Points& GFW::Points::Points::operator=(const Vector2D& vec)
+void GFW::Lighting::LightMap::Invalidate(const SDL_Rect& area)
 {
-	Points p = { vec };
-	v = p.v;
-	midp = p.midp;
-	return *this;
+	for (LightEntry& entry : lights) {
+		SDL_Rect rect = LightRect(entry.light);
+
+		if (entry.used && SDL_HasIntersection(&rect, &area)) {
+			entry.dirty = true;
+		}
+	}
 }
 
-void GFW::Points::Points::Draw(SDL_Renderer* renderer)
+void GFW::Lighting::LightMap::ReadBounds(Occluder& occluder)
 {
-	GFW_SetRenderDrawColor(renderer, color);
+	Points::Points bounds = occluder.polygon->GetBounds();
+	occluder.v.swap(bounds.v);
+
+	//a last vertex repeating the first adds no wall
+	if (occluder.v.size() > 1 && occluder.v.front().x == occluder.v.back().x && occluder.v.front().y == occluder.v.back().y) {
+		occluder.v.pop_back();
+	}
 
-	SDL_Points p = v;
+	if (occluder.v.empty()) {
+		occluder.box = { 0, 0, 0, 0 };
+		return;
+	}
 
-	SDL_RenderDrawLines(renderer, &p.points[0], p.points.size());
+	int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+	for (const Vector2D& p : occluder.v) {
+		minX = min(minX, p.x);
+		minY = min(minY, p.y);
+		maxX = max(maxX, p.x);
+		maxY = max(maxY, p.y);
+	}
+	occluder.box = { minX, minY, maxX - minX + 1, maxY - minY + 1 };
 }
- 
-GFW::Vector2D GFW::Points::RotatePoint(Vector2D origin, Vector2D orginal_point, double angle)
-{
-	Vector2D newpoint;
 
-	angle = (angle) * (M_PI / 180);
-	newpoint.x = round(cos(angle) * (orginal_point.x - origin.x) - sin(angle) * (orginal_point.y - origin.y) + origin.x);
-	newpoint.y = round(sin(angle) * (orginal_point.x - origin.x) + cos(angle) * (orginal_point.y - origin.y) + origin.y);
+void GFW::Lighting::LightMap::AddOccluder(Points::Polygon& occluder)
+{
+	Updatable* updatable = dynamic_cast<Updatable*>(&occluder);
+	occluders.push_back({ &occluder, updatable, updatable != nullptr ? updatable->GetUpdateCount() : 0, {}, { 0, 0, 0, 0 } });
+	ReadBounds(occluders.back());
+	Invalidate(occluders.back().box);
+}
 
-	return newpoint;
+void GFW::Lighting::LightMap::RemoveOccluder(Points::Polygon& occluder)
+{
+	for (size_t i = 0; i < occluders.size(); i++) {
+		if (occluders[i].polygon == &occluder) {
+			Invalidate(occluders[i].box);
+			occluders.erase(occluders.begin() + i);
+			return;
+		}
+	}
 }
 
-GFW::Points::Points GFW::Points::RotatePoints(Points p, double angle)
+int GFW::Lighting::LightMap::AddLight(const Light& light)
 {
-	Points newpoints;
-	newpoints.midp = p.midp;
+	int id;
 
-	for (Vector2D point : p.v) {
-		newpoints.v.push_back(RotatePoint(p.midp, point, angle));
+	if (!freeLights.empty()) {
+		id = freeLights.back();
+		freeLights.pop_back();
+		lights[id].used = true;
+	}
+	else {
+		id = static_cast<int>(lights.size());
+		lights.emplace_back();
 	}
 
-	return newpoints;
+	lights[id].light = light;
+	lights[id].dirty = true;
+	lightChanges++;
+	return id;
 }
 
-void GFW::Image::Image::Draw(SDL_Renderer* renderer)
+void GFW::Lighting::LightMap::SetLight(int id, const Light& light)
 {
-	SDL_RenderCopyEx(renderer, texture, NULL, &rect, angle, NULL, SDL_FLIP_NONE);
+	LightEntry& entry = lights[id];
+
+	//a change of color alone keeps the mask
+	if (entry.light.pos.x != light.pos.x || entry.light.pos.y != light.pos.y || entry.light.radius != light.radius) {
+		entry.dirty = true;
+	}
+	entry.light = light;
+	lightChanges++;
 }
 
-void GFW::Text::FontManager::LoadFont(string fontPath, int fsize, string fontName, int style)
+void GFW::Lighting::LightMap::RemoveLight(int id)
 {
-	if (fontPath == "") {
-		fontName = fontPath.substr(0, fontPath.find_last_of('.'));
-	}
+	lights[id].used = false;
+	lights[id].visibility.clear();
+	lights[id].mask.clear();
+	freeLights.push_back(id);
+	lightChanges++;
+}
 
-	string path = DefaultPath + fontPath;
+void GFW::Lighting::LightMap::Refresh()
+{
+	for (Occluder& occluder : occluders) {
+		//the bounds of an Updatable only change when it is updated, so it isn't copied until then
+		if (occluder.updatable != nullptr) {
+			Uint32 count = occluder.updatable->GetUpdateCount();
+			if (count == occluder.updateCount) {
+				continue;
+			}
+			occluder.updateCount = count;
+		}
 
-	TTF_Font* font = TTF_OpenFont(path.c_str(), fsize);
+		Points::Points bounds = occluder.polygon->GetBounds();
+		size_t n = bounds.v.size();
 
-	TTF_SetFontStyle(font, style);
+		if (n > 1 && bounds.v.front().x == bounds.v.back().x && bounds.v.front().y == bounds.v.back().y) {
+			n--;
+		}
 
-	regF[fontName] = font;
+		bool moved = n != occluder.v.size();
+		for (size_t i = 0; i < n && !moved; i++) {
+			moved = bounds.v[i].x != occluder.v[i].x || bounds.v[i].y != occluder.v[i].y;
+		}
+
+		//the lights which could see it before and after it moved
+		if (moved) {
+			Invalidate(occluder.box);
+			ReadBounds(occluder);
+			Invalidate(occluder.box);
+		}
+	}
 }
 
-void GFW::Text::Text::DoUpdate(SDL_Renderer* renderer)
+const vector<Uint8>& GFW::Lighting::LightMap::GetFalloff(int radius)
 {
-	if (texture != nullptr) {
-		SDL_DestroyTexture(texture);
+	vector<Uint8>& falloff = falloffs[radius];
+
+	if (falloff.empty()) {
+		int r2 = radius * radius;
+		falloff.resize(r2 + 1);
+
+		for (int d2 = 0; d2 <= r2; d2++) {
+			double f = 1 - sqrt(static_cast<double>(d2)) / max(radius, 1);
+			falloff[d2] = static_cast<Uint8>(lround(255 * f * f));
+		}
 	}
+	return falloff;
+}
 
-	SDL_Surface* surface;
+void GFW::Lighting::LightMap::Compute(LightEntry& entry)
+{
+	static vector<Vector2D> walls;
+	static vector<int> rowStart, rowFill;
+	static vector<double> crossings;
 
-	surface = TTF_RenderText_Blended(font, msg.c_str(), color);
+	const Light& light = entry.light;
+	int r = light.radius, size = r * 2 + 1;
+	SDL_Rect area = LightRect(light);
 
-	texture = SDL_CreateTextureFromSurface(renderer, surface);
+	//only the occluders overlapping the light's square are passed to the sweep
+	walls.clear();
+	for (const Occluder& occluder : occluders) {
+		if (occluder.v.size() < 2 || !SDL_HasIntersection(&area, &occluder.box)) {
+			continue;
+		}
 
-	SDL_FreeSurface(surface);
+		//two points make a single wall
+		size_t n = occluder.v.size(), edges = n == 2 ? 1 : n;
+		for (size_t i = 0; i < edges; i++) {
+			walls.push_back(occluder.v[i]);
+			walls.push_back(occluder.v[(i + 1) % n]);
+		}
+	}
 
-	SDL_QueryTexture(texture, NULL, NULL, &size.first, &size.second);
+	ComputeVisibility(light.pos, r, walls, entry.visibility);
+
+	const vector<Uint8>& falloff = GetFalloff(r);
+	int r2 = r * r;
+	entry.mask.assign(static_cast<size_t>(size) * size, 0);
+
+	//the mask is the falloff cut to the visibility polygon, filled by scanline: each edge adds its crossing of
+	//every row center it spans, bucketed by row, and each row is filled between pairs of crossings
+	const vector<Vector2D>& poly = entry.visibility;
+	int n = static_cast<int>(poly.size());
+
+	rowStart.assign(size + 1, 0);
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < n; i++) {
+			Vector2D a = poly[i], b = poly[(i + 1) % n];
+
+			if (a.y == b.y) {
+				continue;
+			}
+			if (b.y < a.y) {
+				swap(a, b);
+			}
+
+			//rows whose centers lie in [a.y, b.y)
+			int y0 = max(a.y - area.y, 0), y1 = min(b.y - area.y, size);
+			for (int y = y0; y < y1; y++) {
+				if (pass == 0) {
+					rowStart[y + 1]++;
+				}
+				else {
+					crossings[rowFill[y]++] = a.x - area.x + (y + area.y + 0.5 - a.y) * (b.x - a.x) / (b.y - a.y);
+				}
+			}
+		}
+
+		if (pass == 0) {
+			for (int y = 0; y < size; y++) {
+				rowStart[y + 1] += rowStart[y];
+			}
+			crossings.resize(rowStart[size]);
+			rowFill.assign(rowStart.begin(), rowStart.end() - 1);
+		}
+	}
+
+	for (int y = 0; y < size; y++) {
+		double* first = crossings.data() + rowStart[y];
+		double* last = crossings.data() + rowStart[y + 1];
+		sort(first, last);
+
+		int dy = y - r;
+		Uint32* row = entry.mask.data() + static_cast<size_t>(y) * size;
+
+		for (double* c = first; c + 1 < last; c += 2) {
+			//pixels whose centers lie in [c[0], c[1])
+			int from = max(static_cast<int>(ceil(c[0] - 0.5)), 0), to = min(static_cast<int>(ceil(c[1] - 0.5)), size);
+
+			for (int x = from; x < to; x++) {
+				int d2 = (x - r) * (x - r) + dy * dy;
+				if (d2 <= r2) {
+					row[x] = static_cast<Uint32>(falloff[d2]) << 24 | 0xFFFFFF;
+				}
+			}
+		}
+	}
+
+	entry.dirty = false;
+	entry.maskDirty = true;
+	computeCount++;
 }
 
-void GFW::Text::Text::Draw(SDL_Renderer* renderer)
+const vector<GFW::Vector2D>& GFW::Lighting::LightMap::GetVisibility(int id)
 {
-	if (texture != nullptr) {
-		SDL_Rect rect = { pos.x, pos.y, size.first, size.second };
-		SDL_RenderCopyEx(renderer, texture, NULL, &rect, angle, NULL, SDL_FLIP_NONE);
+	if (lights[id].dirty) {
+		Compute(lights[id]);
 	}
+	return lights[id].visibility;
 }
 
-GFW::Points::Points GFW::Text::Text::GetBounds() {
-	pair<int, int> size = GetTextSize();
-	return { { pos.x, pos.y, size.first, size.second } };
-};
+void GFW::Lighting::LightMap::Composite(SDL_Renderer* renderer, const Render::Camera* camera)
+{
+	Refresh();
 
-bool GFW::Points::Polygon::detectCollision(Points points) {
-	return Collision::detectCollision(GetBounds(), points);
-}
+	int w = 0, h = 0;
+	SDL_GetRendererOutputSize(renderer, &w, &h);
 
-bool GFW::Points::Polygon::detectCollision(Polygon& poly) {
-	return Collision::detectCollision(GetBounds(), poly.GetBounds());
-}
+	if (target == nullptr || targetW != w || targetH != h) {
+		if (target != nullptr) {
+			SDL_DestroyTexture(target);
+		}
 
-GFW::FVector2D& GFW::FVector2D::operator=(const Vector2D& vec) {
-	x = static_cast<float>(vec.x);
-	y = static_cast<float>(vec.y);
-	return *this;
-};
+		target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
 
-void GFW::Inst::DrawBounds(Points::Polygon& poly, SDL_Color color) {
-	Points::Points points = poly.GetBounds();
-	points.color = color;
-	DrawBounds(points);
+		if (target == nullptr) {
+			cerr << "error: " << SDL_GetError() << endl;
+			return;
+		}
+		SDL_SetTextureBlendMode(target, SDL_BLENDMODE_MOD);
+		targetW = w;
+		targetH = h;
+	}
+
+	{
+		TargetScope scope(renderer, target);
+		scope.Clear(ambient);
+
+		SDL_Rect screen = { 0, 0, w, h };
+
+		for (LightEntry& entry : lights) {
+			SDL_Rect rect = LightRect(entry.light);
+
+			if (!entry.used || entry.light.radius <= 0) {
+				continue;
+			}
+			if (camera != nullptr ? !camera->IsVisible(rect) : !SDL_HasIntersection(&rect, &screen)) {
+				continue;
+			}
+
+			if (entry.dirty) {
+				Compute(entry);
+			}
+
+			if (entry.texture == nullptr || entry.textureSize != rect.w) {
+				if (entry.texture != nullptr) {
+					SDL_DestroyTexture(entry.texture);
+				}
+
+				entry.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, rect.w, rect.h);
+				entry.textureSize = rect.w;
+
+				if (entry.texture == nullptr) {
+					continue;
+				}
+				SDL_SetTextureBlendMode(entry.texture, SDL_BLENDMODE_ADD);
+				entry.maskDirty = true;
+			}
+
+			if (entry.maskDirty) {
+				SDL_UpdateTexture(entry.texture, NULL, entry.mask.data(), rect.w * static_cast<int>(sizeof(Uint32)));
+				entry.maskDirty = false;
+			}
+
+			SDL_SetTextureColorMod(entry.texture, entry.light.color.r, entry.light.color.g, entry.light.color.b);
+			SDL_SetTextureAlphaMod(entry.texture, entry.light.color.a);
+
+			if (camera != nullptr) {
+				double angle = 0;
+				SDL_Rect dst = CameraRect(*camera, rect, angle);
+				SDL_RenderCopyEx(renderer, entry.texture, NULL, &dst, angle, NULL, SDL_FLIP_NONE);
+			}
+			else {
+				SDL_RenderCopy(renderer, entry.texture, NULL, &rect);
+			}
+		}
+	}
+
+	SDL_RenderCopy(renderer, target, NULL, NULL);
 }
 
+void GFW::Lighting::LightMap::Draw(SDL_Renderer* renderer)
+{
+	Composite(renderer, nullptr);
+}
 
-GFW::Points::SDL_Points::SDL_Points(const vector<Vector2D>& v)
+void GFW::Lighting::LightMap::DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera)
 {
-	for (Vector2D p : v) {
-		points.push_back({ p.x, p.y });
-	}
-	points.push_back(points[0]);
+	Composite(renderer, camera.IsIdentity() ? nullptr : &camera);
 }
 
-GFW::Points::SDL_Points& GFW::Points::SDL_Points::operator=(const vector<Vector2D>& v)
+bool GFW::Lighting::LightMap::Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera)
 {
-	points.clear();
-	for (Vector2D p : v) {
-		points.push_back({p.x, p.y});
-	}
+	Refresh();
 
-	points.push_back(points[0]);
+	int w = target.GetWidth(), h = target.GetHeight();
+	SDL_Rect screen = { 0, 0, w, h };
+	bool transform = !camera.IsIdentity();
 
-	return *this;
-}
+	//the same image Composite builds in its texture: the ambient color with every light's mask added onto it
+	lightPixels.assign(static_cast<size_t>(w) * h, 0xFF000000 | ambient.r << 16 | ambient.g << 8 | ambient.b);
 
-void GFW::Circle::Circle::Draw(SDL_Renderer* renderer) {
-	GFW_SetRenderDrawColor(renderer, color);
-	int r2 = pow(r, 2);
-	for (int y = -r; y <= r; y++) {
-		for (int x = -r; x <= r; x++) {
-			if(pow(x, 2) + pow(y, 2) <= r2) {
-				SDL_RenderDrawPoint(renderer, x + pos.x, y + pos.y);
+	for (LightEntry& entry : lights) {
+		SDL_Rect rect = LightRect(entry.light);
+
+		if (!entry.used || entry.light.radius <= 0) {
+			continue;
+		}
+		if (transform ? !camera.IsVisible(rect) : !SDL_HasIntersection(&rect, &screen)) {
+			continue;
+		}
+
+		if (entry.dirty) {
+			Compute(entry);
+		}
+
+		double angle = 0;
+		SDL_Rect dst = transform ? CameraRect(camera, rect, angle) : rect;
+		SDL_Rect bounds = RotatedRectBounds(dst, angle), clip;
+
+		if (dst.w <= 0 || dst.h <= 0 || !SDL_IntersectRect(&bounds, &screen, &clip)) {
+			continue;
+		}
+
+		//each pixel samples the mask like SoftwareRenderer::CopyEx, and adds it like SDL_BLENDMODE_ADD with the light's mods
+		SDL_Color color = entry.light.color;
+		double cosA = cos(angle * (M_PI / 180)), sinA = sin(angle * (M_PI / 180));
+		double cx = dst.x + dst.w / 2.0, cy = dst.y + dst.h / 2.0;
+		double uScale = static_cast<double>(rect.w) / dst.w, vScale = static_cast<double>(rect.h) / dst.h;
+
+		for (int y = clip.y; y < clip.y + clip.h; y++) {
+			double dy = y + 0.5 - cy;
+			Uint32* row = lightPixels.data() + static_cast<size_t>(y) * w;
+
+			for (int x = clip.x; x < clip.x + clip.w; x++) {
+				double dx = x + 0.5 - cx;
+				double u = (cosA * dx + sinA * dy) * uScale + rect.w / 2.0;
+				double v = (-sinA * dx + cosA * dy) * vScale + rect.h / 2.0;
+
+				if (u < 0 || v < 0 || u >= rect.w || v >= rect.h) {
+					continue;
+				}
+
+				Uint8 a = ModulateChannel(entry.mask[static_cast<size_t>(v) * rect.w + static_cast<size_t>(u)] >> 24, color.a);
+				if (a == 0) {
+					continue;
+				}
+
+				Uint32 p = row[x];
+				auto add = [p, a](int shift, Uint8 c) { return min<Uint32>(255, ((p >> shift) & 0xFF) + ModulateChannel(c, a)) << shift; };
+				row[x] = 0xFF000000 | add(16, color.r) | add(8, color.g) | add(0, color.b);
 			}
 		}
 	}
+
+	target.Modulate(lightPixels.data(), screen);
+	return true;
 }
 
-void GFW::Circle::Circle::DoUpdate(SDL_Renderer* renderer)
+void GFW::Lighting::LightMap::Destroy()
 {
-	double inc = min(0.5 / r, M_PI / 2);
-	double max = (M_PI * 2);
-
-	double angle = 0;
+	for (LightEntry& entry : lights) {
+		if (entry.texture != nullptr) {
+			SDL_DestroyTexture(entry.texture);
+			entry.texture = nullptr;
+		}
+	}
 
-	BoundingBox.midp = pos;
-	BoundingBox.v.clear();
-	while (angle < max) {
-		BoundingBox.v.push_back({int( round( r * cos(angle) ) + pos.x), int(round(r * sin(angle)) + pos.y) });
-		angle += inc;
+	if (target != nullptr) {
+		SDL_DestroyTexture(target);
+		target = nullptr;
 	}
-	BoundingBox.color = color;
 }
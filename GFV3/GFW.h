@@ -43,16 +43,313 @@ namespace GFW {
 
 	class Inst;
 
+	/**
+	 *  \brief Contains optional instrumentation of the frame loop
+	 *
+	 *  Heap allocations are only tracked when GFW_ALLOC_STATS is defined (in the project's preprocessor definitions),
+	 *  otherwise all of these functions compile down to nothing
+	 */
+	namespace Profiling {
+
+		/**
+		 *  \brief The named phases of a frame to which allocations are attributed
+		 */
+		enum FramePhase {
+			PHASE_OTHER,
+			PHASE_INPUT,
+			PHASE_UPDATE,
+			PHASE_COLLIDE,
+			PHASE_DRAW,
+			PHASE_PRESENT,
+			PHASE_COUNT
+		};
+
+		/**
+		 *  \brief The number and total size of the allocations made in one phase
+		 */
+		struct PhaseAllocStats {
+			Uint64 count = 0;
+			Uint64 bytes = 0;
+		};
+
+		/**
+		 *  \brief The allocations made during one frame, split up by FramePhase
+		 */
+		struct FrameAllocStats {
+			PhaseAllocStats phases[PHASE_COUNT];
+		};
+
+		/**
+		 *  \return a printable name for the given phase
+		 */
+		const char* PhaseName(FramePhase phase);
+
+#ifdef GFW_ALLOC_STATS
+		/**
+		 *  \brief Attributes all following allocations on any thread to the given phase
+		 *
+		 *  \param phase the new phase
+		 *
+		 *  \return the previous phase
+		 *
+		 *  \sa PhaseScope
+		 */
+		FramePhase SetPhase(FramePhase phase);
+
+		/**
+		 *  \brief Closes the current frame's allocation counts and starts a new frame (called by Inst::pres())
+		 *
+		 *  \sa GetLastFrameAllocStats()
+		 */
+		void EndFrame();
+
+		/**
+		 *  \return the allocations made during the last completed frame
+		 */
+		FrameAllocStats GetLastFrameAllocStats();
+
+		/**
+		 *  \brief Prints per-frame averages and maxima for every phase and the most frequent allocation call sites
+		 *
+		 *  This is called automatically at exit
+		 */
+		void PrintAllocReport();
+#else
+		inline FramePhase SetPhase(FramePhase phase) { return PHASE_OTHER; }
+		inline void EndFrame() {}
+		inline FrameAllocStats GetLastFrameAllocStats() { return FrameAllocStats(); }
+		inline void PrintAllocReport() {}
+#endif
+
+		/**
+		 *  \brief Attributes allocations to the given phase for as long as this object is alive
+		 */
+		class PhaseScope {
+		public:
+			PhaseScope(FramePhase phase) : previous(SetPhase(phase)) {}
+			~PhaseScope() { SetPhase(previous); }
+		private:
+			FramePhase previous;
+		};
+	}
+
+
+#ifndef GFW_FIXED_FRACTION_BITS
+#define GFW_FIXED_FRACTION_BITS 16
+#endif
+
+#ifndef GFW_FIXED_TRIG_STEPS
+#define GFW_FIXED_TRIG_STEPS 4096
+#endif
+
+	/**
+	 *  \brief A signed fixed-point number with GFW_FIXED_FRACTION_BITS fractional bits (16.16 by default)
+	 *
+	 *  All arithmetic is done on integers so results are identical on every machine and compiler
+	 *
+	 *  \sa Scalar
+	 */
+	struct Fixed {
+		static const int FractionBits = GFW_FIXED_FRACTION_BITS;
+		static const Sint32 One = 1 << FractionBits;
+
+		/**
+		 *  \brief The underlying integer representation of this number (value * One)
+		 */
+		Sint32 raw = 0;
+
+		Fixed() {}
+		Fixed(int i) : raw(i * One) {}
+		explicit Fixed(double d) : raw(static_cast<Sint32>(d * One + (d < 0 ? -0.5 : 0.5))) {}
+
+		/**
+		 *  \return a Fixed with the given underlying integer representation
+		 */
+		static Fixed FromRaw(Sint32 r) { Fixed f; f.raw = r; return f; }
+
+		/**
+		 *  \return this number rounded to the nearest integer
+		 */
+		int ToInt() const { return (raw + (One >> 1)) >> FractionBits; }
+
+		/**
+		 *  \return this number converted to a double (for display only, not for simulation)
+		 */
+		double ToDouble() const { return static_cast<double>(raw) / One; }
+
+		Fixed operator-() const { return FromRaw(-raw); }
+		Fixed operator+(Fixed o) const { return FromRaw(raw + o.raw); }
+		Fixed operator-(Fixed o) const { return FromRaw(raw - o.raw); }
+		Fixed operator*(Fixed o) const { return FromRaw(static_cast<Sint32>((static_cast<Sint64>(raw) * o.raw) >> FractionBits)); }
+		Fixed operator/(Fixed o) const { return FromRaw(static_cast<Sint32>((static_cast<Sint64>(raw) << FractionBits) / o.raw)); }
+		Fixed& operator+=(Fixed o) { raw += o.raw; return *this; }
+		Fixed& operator-=(Fixed o) { raw -= o.raw; return *this; }
+		Fixed& operator*=(Fixed o) { return *this = *this * o; }
+		Fixed& operator/=(Fixed o) { return *this = *this / o; }
+		bool operator==(Fixed o) const { return raw == o.raw; }
+		bool operator!=(Fixed o) const { return raw != o.raw; }
+		bool operator<(Fixed o) const { return raw < o.raw; }
+		bool operator>(Fixed o) const { return raw > o.raw; }
+		bool operator<=(Fixed o) const { return raw <= o.raw; }
+		bool operator>=(Fixed o) const { return raw >= o.raw; }
+	};
+
+	/**
+	 *  \brief The scalar type used by FVector2D, the rotation code and the collision code
+	 *
+	 *  Defining GFW_FIXED_POINT (in the project's preprocessor definitions) switches it from float to Fixed,
+	 *  which makes geometry and collision results bit-identical across machines
+	 */
+#ifdef GFW_FIXED_POINT
+	typedef Fixed Scalar;
+#else
+	typedef float Scalar;
+#endif
+
+	/**
+	 *  \brief Looks up a sine from a precomputed fixed-point table
+	 *
+	 *  \param step the angle in table steps, where GFW_FIXED_TRIG_STEPS steps make a full turn
+	 *
+	 *  \return the sine of the given angle
+	 *
+	 *  \sa FixedCos()
+	 *  \sa FixedAngleSteps()
+	 */
+	Fixed FixedSin(int step);
+
+	/**
+	 *  \brief Looks up a cosine from a precomputed fixed-point table
+	 *
+	 *  \param step the angle in table steps, where GFW_FIXED_TRIG_STEPS steps make a full turn
+	 *
+	 *  \return the cosine of the given angle
+	 *
+	 *  \sa FixedSin()
+	 */
+	Fixed FixedCos(int step);
+
+	/**
+	 *  \brief Converts an angle in degrees to the nearest trig table step
+	 *
+	 *  \param angle the angle (in degrees)
+	 *
+	 *  \return the angle in table steps, in the range [0, GFW_FIXED_TRIG_STEPS)
+	 */
+	int FixedAngleSteps(double angle);
 
 	struct Vector2D { int x, y; };
 	struct FVector2D {
-		float x, y;
+		Scalar x, y;
 		FVector2D() : x(0), y(0) {}
-		FVector2D(float x, float y) : x(x), y(y) {}
-		FVector2D(const Vector2D& vec) : x(static_cast<float>(vec.x)), y(static_cast<float>(vec.y)) {}
+		FVector2D(Scalar x, Scalar y) : x(x), y(y) {}
+		FVector2D(const Vector2D& vec) : x(static_cast<Scalar>(vec.x)), y(static_cast<Scalar>(vec.y)) {}
 		FVector2D& operator=(const Vector2D& vec);
 	};
 
+	/**
+	 *  \brief Contains classes for ordering and batching rendering work
+	 */
+	namespace Render {
+		/**
+		 *  \brief The SDL state a Drawable needs when it is drawn, used to group draws which share state
+		 */
+		struct RenderState {
+			/**
+			 *  \brief The texture which will be copied, or nullptr if the draw only uses the draw color
+			 */
+			SDL_Texture* texture = nullptr;
+			SDL_BlendMode blendMode = SDL_BLENDMODE_BLEND;
+			SDL_Color color = { 255, 255, 255, 255 };
+			/**
+			 *  \brief Changes whenever the drawable's appearance changes without any of the other values changing
+			 */
+			Uint32 version = 0;
+		};
+
+		class SoftwareRenderer;
+
+		/**
+		 *  \brief A view onto the world which is scrolled, zoomed and rotated around the center of its viewport
+		 *
+		 *  With the default values world coordinates are screen coordinates
+		 *
+		 *  \sa Inst::SetCamera()
+		 */
+		class Camera {
+		public:
+			/**
+			 *  \brief The scroll offset of the view (the world point shown at the top-left corner when not zoomed or rotated)
+			 */
+			double x = 0, y = 0;
+			/**
+			 *  \brief The scale from world to screen units
+			 */
+			double zoom = 1;
+			/**
+			 *  \brief The angle (in degrees) by which the view is rotated (the world appears rotated the other way)
+			 */
+			double rotation = 0;
+			/**
+			 *  \brief The screen area the view is drawn into (an empty rect means the whole render target)
+			 *
+			 *  Drawing is not clipped to it, set a clip rect for that
+			 */
+			SDL_Rect viewport = { 0, 0, 0, 0 };
+
+			/**
+			 *  \return whether this camera leaves world coordinates unchanged
+			 */
+			bool IsIdentity() const { return x == 0 && y == 0 && zoom == 1 && rotation == 0 && viewport.x == 0 && viewport.y == 0; }
+
+			/**
+			 *  \brief Sets the size of the render target, used when viewport is empty
+			 */
+			void SetScreenSize(int w, int h) { screenW = w; screenH = h; }
+
+			/**
+			 *  \return the screen position of the given world position
+			 */
+			Vector2D WorldToScreen(Vector2D world) const;
+
+			/**
+			 *  \brief Transforms the given world position without rounding it to whole pixels
+			 */
+			void WorldToScreen(double wx, double wy, double& sx, double& sy) const;
+
+			/**
+			 *  \return the world position of the given screen position
+			 */
+			Vector2D ScreenToWorld(Vector2D screen) const;
+
+			/**
+			 *  \return the axis-aligned world area which contains everything visible through this camera
+			 */
+			SDL_Rect GetViewBounds() const;
+
+			/**
+			 *  \return whether any part of the given world area can be visible through this camera
+			 */
+			bool IsVisible(const SDL_Rect& world) const;
+
+			/**
+			 *  \return the screen area this camera draws into, the whole render target when viewport is empty
+			 */
+			SDL_Rect GetViewport() const;
+
+		private:
+			int screenW = 0, screenH = 0;
+
+			/**
+			 *  \brief The last result of GetViewBounds() and the values it was computed from, so culling many rects
+			 *  through an unchanged camera only transforms the view corners once
+			 */
+			mutable bool boundsKnown = false;
+			mutable SDL_Rect bounds;
+			mutable double boundsKey[10];
+		};
+	}
+
 	/**
 	 *  \brief A common interface for classes which support drawing of themselves onto a ::SDL_Renderer
 	 */
@@ -64,6 +361,39 @@ namespace GFW {
 		 *  \param renderer the renderer on which to draw
 		 */
 		virtual void Draw(SDL_Renderer* renderer) = 0;
+
+		/**
+		 *  \return the SDL state this object will use when it is drawn (used to sort a Render::RenderQueue)
+		 */
+		virtual Render::RenderState GetRenderState() { return Render::RenderState(); }
+
+		/**
+		 *  \brief Retrieves the screen area this object covers when it is drawn (used by the dirty rect mode of Inst)
+		 *
+		 *  \param rect set to the covered area
+		 *
+		 *  \return whether the area is known (objects with an unknown area are redrawn every frame)
+		 */
+		virtual bool GetDrawRect(SDL_Rect& rect) { return false; }
+
+		/**
+		 *  \brief Draws this object as seen through the given camera
+		 *
+		 *  The default implementation ignores the camera, classes which are placed in world coordinates should override it
+		 *
+		 *  \param renderer the renderer on which to draw
+		 *  \param camera the camera through which to draw
+		 */
+		virtual void DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera) { Draw(renderer); }
+
+		/**
+		 *  \brief Records this object's drawing commands into a software renderer
+		 *
+		 *  \param target the SoftwareRenderer which records the commands
+		 *  \param camera the camera through which to draw
+		 *  \return false if this object can't be drawn in software (the default)
+		 */
+		virtual bool Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera) { return false; }
 	};
 
 	/**
@@ -78,7 +408,7 @@ namespace GFW {
 		 * 
 		 *  \sa NeedsUpdate()
 		 */
-		void Update(SDL_Renderer* renderer) { needsUpdate = false; DoUpdate(renderer); };
+		void Update(SDL_Renderer* renderer) { needsUpdate = false; updateCount++; DoUpdate(renderer); };
 
 		/**
 		 *  \return Whether this object has requested that that its Update function be called
@@ -95,6 +425,13 @@ namespace GFW {
 		 *  \sa NeedsUpdate()
 		 */
 		void RequestUpdate() { needsUpdate = true; }
+
+		/**
+		 *  \return the number of times this object has been updated, which changes whenever its members were updated
+		 * 
+		 *  \sa Update()
+		 */
+		Uint32 GetUpdateCount() { return updateCount; }
 	protected:
 		/**
 		 *  \brief Preforms the required updates on this object's member values
@@ -106,8 +443,13 @@ namespace GFW {
 		virtual void DoUpdate(SDL_Renderer* renderer) = 0;
 	private:
 		bool needsUpdate = true;
+		Uint32 updateCount = 0;
 	};
 
+	namespace Collision {
+		struct AnyShape;
+	}
+
 	/**
 	 *  \brief Contains classes and functions for storing and working with points and shapes
 	 */
@@ -138,6 +480,10 @@ namespace GFW {
 			 *  \brief A ::SDL_Color which will be used to draw these points if requested
 			 */
 			SDL_Color color;
+			/**
+			 *  \brief Whether Draw fills the polygon formed by these points (convex or concave, without holes) instead of drawing its outline
+			 */
+			bool filled = false;
 
 			Points() {}
 			Points(vector<Vector2D> v, Vector2D midp) : v(v), midp(midp) {}
@@ -157,7 +503,52 @@ namespace GFW {
 			 *  \sa color
 			 */
 			void Draw(SDL_Renderer* renderer);
+
+			/**
+			 *  \brief Splits the polygon formed by these points into triangles, unless v is unchanged since the last call
+			 *
+			 *  \return the vertex indices of the triangles, three per triangle
+			 */
+			const vector<int>& Triangulate();
+
+			Render::RenderState GetRenderState() { Render::RenderState state; state.color = color; state.version = filled; return state; }
+
+			bool GetDrawRect(SDL_Rect& rect);
+
+			void DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera);
+
+			bool Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera);
+
+		private:
+			void DrawFilled(SDL_Renderer* renderer, const vector<Vector2D>& vertices);
+
+			/**
+			 *  \brief The triangles found by Triangulate() and the vertices they were found for, a cache which const
+			 *  Points may fill in too (like Inst::DrawBounds does when drawing them)
+			 */
+			mutable vector<int> triangles;
+			mutable vector<Vector2D> triangulated;
 		};
+
+		/**
+		 *  \brief Splits a simple polygon into triangles by ear clipping
+		 *
+		 *  \param vertices the outline of the polygon, in either winding order (a last vertex repeating the first is ignored)
+		 *  \param triangles cleared and then filled with the vertex indices of the triangles, three per triangle
+		 */
+		void Triangulate(const vector<Vector2D>& vertices, vector<int>& triangles);
+
+		/**
+		 *  \brief Computes the horizontal pixel spans covered by the given triangles
+		 *
+		 *  A pixel is covered when its center is inside a triangle, with the right and bottom edges excluded,
+		 *  so triangles which share an edge neither overlap nor leave gaps
+		 *
+		 *  \param spans cleared and then filled with one rect per span, touching spans of a row are merged
+		 *  \param vertices the vertices of the triangles
+		 *  \param triangles the vertex indices of the triangles, three per triangle
+		 */
+		void TriangleSpans(vector<SDL_Rect>& spans, const vector<Vector2D>& vertices, const vector<int>& triangles);
 		
 		/**
 		 *  \brief Represents a convex polygon which is defined by a ::Points::Points object
@@ -169,6 +560,13 @@ namespace GFW {
 			 */
 			virtual Points GetBounds() = 0;
 
+			/**
+			 *  \brief Describes this Polygon as one of the shape kinds known to Collision, without copying its bounds
+			 *
+			 *  \return the shape of this Polygon, or a shape of kind Collision::SHAPE_NONE if only GetBounds() is available
+			 */
+			virtual Collision::AnyShape GetShape();
+
 			/**
 			 *  \brief detects if this polygon intersects the polygon formed by the given ::Points::Points object
 			 */
@@ -222,93 +620,354 @@ namespace GFW {
 		/**
 		 *  \return whether the two Points objects intercect
 		 */
-		bool detectCollision(Points::Points a, Points::Points b);
+		bool detectCollision(const Points::Points& a, const Points::Points& b);
 
 		/**
 		 *  \return whether the two Points objects intercect using the DIAG Algorithm
 		 */
-		bool checkshape_Dalg(Points::Points a, Points::Points b);
+		bool checkshape_Dalg(const Points::Points& a, const Points::Points& b);
 
 		/**
 		 *  \return whether the two Points objects intercect using the SAT Algorithm
 		 */
-		bool checkshape_SATalg(Points::Points p1, Points::Points p2);
-	}
+		bool checkshape_SATalg(const Points::Points& p1, const Points::Points& p2);
 
-	/**
-	 *  \brief Contains classes and functions for working with images
-	 */
-	namespace Image {
 		/**
-		 *  \brief Represents an image
+		 *  \brief The kinds of shapes which have specialized collision routines
 		 */
-		struct Image : Points::Polygon, Drawable, Updatable {
+		enum ShapeKind {
+			SHAPE_AABB,
+			SHAPE_OBB,
+			SHAPE_CIRCLE,
+			SHAPE_CONVEX_POLY,
+			SHAPE_KIND_COUNT,
 			/**
-			 *  \brief A SDL_Rect representing the rectangle containing this image
-			 */
-			SDL_Rect rect;
-			/**
-			 *  \brief A SDL_Texture storing the data contained by this image
-			 */
-			SDL_Texture* texture;
-			/**
-			 *  \brief A Points object representing the bounds of this image
-			 */
-			Points::Points BoundingBox;
-			/**
-			 *  \brief An angle which this image will be rotated by when being rendered
+			 *  \brief Marks an AnyShape which holds no shape
 			 */
-			double angle = 0.0;
+			SHAPE_NONE = SHAPE_KIND_COUNT
+		};
 
-			/**
-			 *  \brief Updates the rect member of this image to move its top-left corner to the given position
-			 * 
-			 *  \param pos the new position of the top-left corner
-			 * 
-			 *  \sa GetX()
-			 *  \sa GetY()
-			 */
-			void SetPos(Vector2D pos) { rect.x = pos.x; rect.y = pos.y; }
+		/**
+		 *  \brief An axis-aligned rectangle, with edges inclusive like the bounds made by Points::GetRectBounds()
+		 */
+		struct AABB {
+			static const ShapeKind Kind = SHAPE_AABB;
+			int x, y, w, h;
 
-			/**
-			 *  \brief Sets the width and height of this image
-			 *
-			 *  \param s a std::pair of the form { newWidth, newHeight }
-			 * 
-			 *  \sa GetW()
-			 *  \sa GetH()
-			 */
-			void SetSize(pair<int, int> s) { rect.w = s.first; rect.h = s.second; }
+			AABB() : x(0), y(0), w(0), h(0) {}
+			AABB(int x, int y, int w, int h) : x(x), y(y), w(w), h(h) {}
+			AABB(const SDL_Rect& rect) : x(rect.x), y(rect.y), w(rect.w), h(rect.h) {}
+		};
 
+		/**
+		 *  \brief A rectangle rotated around its center
+		 */
+		struct OBB {
+			static const ShapeKind Kind = SHAPE_OBB;
 			/**
-			 *  \return the X position of the top-left corner where this image will be rendered
-			 * 
-			 *  \sa SetPos()
+			 *  \brief The corners of the rectangle in winding order
 			 */
-			int GetX() { return rect.x; }
+			Vector2D corners[4];
 
+			OBB() {}
 			/**
-			 *  \return the Y position of the top-left corner where this image will be rendered
-			 * 
-			 *  \sa SetPos()
+			 *  \param rect the unrotated rectangle
+			 *  \param angle the angle (in degrees) by which the rectangle is rotated around its center (counter-clockwise)
 			 */
-			int GetY() { return rect.y; }
+			OBB(const SDL_Rect& rect, double angle);
+		};
 
-			/**
-			 *  \return the width of this image
-			 *
-			 *  \sa SetSize()
-			 */
-			int GetW() { return rect.w; }
+		/**
+		 *  \brief A circle
+		 */
+		struct CircleShape {
+			static const ShapeKind Kind = SHAPE_CIRCLE;
+			Vector2D center;
+			int r;
 
-			/**
-			 *  \return the height of this image
-			 *
-			 *  \sa SetSize()
-			 */
-			int GetH() { return rect.h; }
+			CircleShape() : center({ 0, 0 }), r(0) {}
+			CircleShape(Vector2D center, int r) : center(center), r(r) {}
+		};
 
-			Points::Points GetBounds() { return BoundingBox; }
+		/**
+		 *  \brief A convex polygon which refers to (and does not copy) the vertices of a Points object
+		 *
+		 *  The Points object must outlive this shape
+		 */
+		struct ConvexPoly {
+			static const ShapeKind Kind = SHAPE_CONVEX_POLY;
+			const Vector2D* v;
+			int count;
+
+			ConvexPoly() : v(nullptr), count(0) {}
+			ConvexPoly(const Points::Points& points) : v(points.v.data()), count(static_cast<int>(points.v.size())) {}
+		};
+
+		/**
+		 *  \brief Holds any one of the shape kinds so that shapes of different kinds can be stored together
+		 *
+		 *  \sa Intersects()
+		 */
+		struct AnyShape {
+			ShapeKind kind;
+			union {
+				AABB aabb;
+				OBB obb;
+				CircleShape circle;
+				ConvexPoly poly;
+			};
+
+			AnyShape() : kind(SHAPE_NONE) {}
+			AnyShape(const AABB& s) : kind(SHAPE_AABB), aabb(s) {}
+			AnyShape(const OBB& s) : kind(SHAPE_OBB), obb(s) {}
+			AnyShape(const CircleShape& s) : kind(SHAPE_CIRCLE), circle(s) {}
+			AnyShape(const ConvexPoly& s) : kind(SHAPE_CONVEX_POLY), poly(s) {}
+		};
+
+		/**
+		 *  \brief Holds the specialized intersection routine for a pair of shape kinds
+		 *
+		 *  Each unordered pair is specialized once, the primary template forwards to the swapped pair
+		 */
+		template<typename A, typename B>
+		struct Collider {
+			static bool Test(const A& a, const B& b) { return Collider<B, A>::Test(b, a); }
+		};
+
+		template<> struct Collider<AABB, AABB> {
+			static bool Test(const AABB& a, const AABB& b) { return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h; }
+		};
+		template<> struct Collider<AABB, OBB> { static bool Test(const AABB& a, const OBB& b); };
+		template<> struct Collider<AABB, CircleShape> { static bool Test(const AABB& a, const CircleShape& b); };
+		template<> struct Collider<AABB, ConvexPoly> { static bool Test(const AABB& a, const ConvexPoly& b); };
+		template<> struct Collider<OBB, OBB> { static bool Test(const OBB& a, const OBB& b); };
+		template<> struct Collider<OBB, CircleShape> { static bool Test(const OBB& a, const CircleShape& b); };
+		template<> struct Collider<OBB, ConvexPoly> { static bool Test(const OBB& a, const ConvexPoly& b); };
+		template<> struct Collider<CircleShape, CircleShape> { static bool Test(const CircleShape& a, const CircleShape& b); };
+		template<> struct Collider<CircleShape, ConvexPoly> { static bool Test(const CircleShape& a, const ConvexPoly& b); };
+		template<> struct Collider<ConvexPoly, ConvexPoly> { static bool Test(const ConvexPoly& a, const ConvexPoly& b); };
+
+		/**
+		 *  \brief Tests two shapes whose kinds are known at compile time, using the routine specialized for that pair
+		 *
+		 *  \return whether the two shapes intersect
+		 */
+		template<typename A, typename B>
+		bool Intersects(const A& a, const B& b) { return Collider<A, B>::Test(a, b); }
+
+		/**
+		 *  \brief Tests two shapes whose kinds are only known at runtime through a table of the specialized routines
+		 *
+		 *  \return whether the two shapes intersect (false if either holds no shape)
+		 */
+		bool Intersects(const AnyShape& a, const AnyShape& b);
+	}
+
+	/**
+	 *  \brief Contains classes and functions for working with images
+	 */
+	namespace Image {
+		/**
+		 *  \brief Shares one texture between every Image loaded from the same file
+		 *
+		 *  Paths are normalized before lookup (backslashes count as slashes), so "./images/a.png" and "images/a.png" are the
+		 *  same entry. Acquire hands out a Handle, every copy of which holds a reference, and the texture is destroyed
+		 *  when the last copy is destroyed or reset.
+		 *
+		 *  \sa Image::textureCache
+		 */
+		class TextureCache {
+			struct Entry;
+
+		public:
+			TextureCache() {}
+			TextureCache(const TextureCache&) = delete;
+			TextureCache& operator=(const TextureCache&) = delete;
+			~TextureCache();
+
+			/**
+			 *  \brief A counted reference to a cached texture, copying it adds a reference and destroying it drops one
+			 */
+			class Handle {
+			public:
+				Handle() {}
+				Handle(const Handle& other);
+				Handle& operator=(const Handle& other);
+				~Handle() { Reset(); }
+
+				/**
+				 *  \return the texture, or nullptr if the handle is empty or its cache was cleared
+				 */
+				SDL_Texture* Get() const;
+
+				/**
+				 *  \brief Drops the reference, leaving the handle empty
+				 */
+				void Reset();
+
+			private:
+				friend class TextureCache;
+				Handle(TextureCache* cache, Entry* entry) : cache(cache), entry(entry) {}
+
+				TextureCache* cache = nullptr;
+				Entry* entry = nullptr;
+			};
+
+			/**
+			 *  \brief Returns the texture loaded from the given file, loading it first if it isn't resident
+			 *
+			 *  \param img_path a path to the file from which to load the image
+			 *  \param renderer the SDL_Renderer which will draw the texture
+			 *
+			 *  \return a reference to the texture, which is empty if the file couldn't be loaded
+			 */
+			Handle Acquire(string img_path, SDL_Renderer* renderer);
+
+			/**
+			 *  \return the number of references to the given texture
+			 */
+			int GetRefCount(SDL_Texture* texture);
+
+			/**
+			 *  \brief Destroys every texture regardless of references (must be called before the renderer which drew them is destroyed)
+			 *
+			 *  Handles which are still held afterwards return nullptr and no longer touch the cache.
+			 */
+			void Clear();
+
+			/**
+			 *  \return the number of resident textures
+			 */
+			size_t GetCount() { return entries.size(); }
+
+			/**
+			 *  \return the number of bytes of texture memory used by the resident textures
+			 */
+			size_t GetUsage() { return usage; }
+
+			/**
+			 *  \return the number of calls to Acquire which found their texture resident
+			 */
+			Uint64 GetHits() { return hits; }
+
+			/**
+			 *  \return the number of calls to Acquire which had to load their file
+			 */
+			Uint64 GetMisses() { return misses; }
+
+			/**
+			 *  \return the given path with separators unified and "." and ".." segments resolved
+			 */
+			static string Canonical(const string& path);
+
+		private:
+			typedef pair<SDL_Renderer*, string> Key;
+
+			struct Entry {
+				/**
+				 *  \brief The texture, or nullptr once the cache was cleared while handles still held the entry
+				 */
+				SDL_Texture* texture;
+				int refs;
+				size_t bytes;
+				Key key;
+			};
+
+			void Drop(Entry* entry);
+			void Orphan();
+
+			/**
+			 *  \brief The entries are owned by the cache until it is cleared, then by the handles still holding them
+			 */
+			map<Key, Entry*> entries;
+			unordered_map<SDL_Texture*, Entry*> keys;
+			size_t usage = 0;
+			Uint64 hits = 0;
+			Uint64 misses = 0;
+		};
+
+		/**
+		 *  \brief Represents an image
+		 */
+		struct Image : Points::Polygon, Drawable, Updatable {
+			/**
+			 *  \brief A SDL_Rect representing the rectangle containing this image
+			 */
+			SDL_Rect rect;
+			/**
+			 *  \brief A SDL_Texture storing the data contained by this image
+			 */
+			SDL_Texture* texture;
+			/**
+			 *  \brief Keeps texture loaded while this Image or a copy of it exists, empty unless texture came from textureCache
+			 */
+			TextureCache::Handle textureRef;
+			/**
+			 *  \brief The part of texture which holds this image, or an empty rect if it is the whole texture
+			 *
+			 *  \sa AtlasBuilder
+			 */
+			SDL_Rect srcRect = { 0, 0, 0, 0 };
+			/**
+			 *  \brief A Points object representing the bounds of this image
+			 */
+			Points::Points BoundingBox;
+			/**
+			 *  \brief An angle which this image will be rotated by when being rendered
+			 */
+			double angle = 0.0;
+
+			/**
+			 *  \brief Updates the rect member of this image to move its top-left corner to the given position
+			 * 
+			 *  \param pos the new position of the top-left corner
+			 * 
+			 *  \sa GetX()
+			 *  \sa GetY()
+			 */
+			void SetPos(Vector2D pos) { rect.x = pos.x; rect.y = pos.y; }
+
+			/**
+			 *  \brief Sets the width and height of this image
+			 *
+			 *  \param s a std::pair of the form { newWidth, newHeight }
+			 * 
+			 *  \sa GetW()
+			 *  \sa GetH()
+			 */
+			void SetSize(pair<int, int> s) { rect.w = s.first; rect.h = s.second; }
+
+			/**
+			 *  \return the X position of the top-left corner where this image will be rendered
+			 * 
+			 *  \sa SetPos()
+			 */
+			int GetX() { return rect.x; }
+
+			/**
+			 *  \return the Y position of the top-left corner where this image will be rendered
+			 * 
+			 *  \sa SetPos()
+			 */
+			int GetY() { return rect.y; }
+
+			/**
+			 *  \return the width of this image
+			 *
+			 *  \sa SetSize()
+			 */
+			int GetW() { return rect.w; }
+
+			/**
+			 *  \return the height of this image
+			 *
+			 *  \sa SetSize()
+			 */
+			int GetH() { return rect.h; }
+
+			Points::Points GetBounds() { return BoundingBox; }
+
+			Collision::AnyShape GetShape();
 
 			/**
 			 *  \brief Draws this image at the position specified by rect and with the given angle onto the given renderer
@@ -317,14 +976,57 @@ namespace GFW {
 			 */
 			void Draw(SDL_Renderer* renderer);
 
+			/**
+			 *  \return the texture, with srcRect folded into the version so a changed animation frame counts as a change
+			 */
+			Render::RenderState GetRenderState();
+
+			bool GetDrawRect(SDL_Rect& rect);
+
+			void DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera);
+
+			bool Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera);
+
 			/**
 			 *  \brief Updates the bounding box of this image to correspond to its rect member value
 			 */
 			void DoUpdate(SDL_Renderer* renderer) { BoundingBox = rect; }
+
+			/**
+			 *  \brief The TextureCache which CreateImg and SpriteSheet::Load load through
+			 */
+			static TextureCache textureCache;
 		};
 
 		/**
-		 *  \brief creates an image from the given file path
+		 *  \return the blend mode for textures whose colors are premultiplied by their alpha
+		 */
+		SDL_BlendMode PremultipliedBlendMode();
+
+		/**
+		 *  \brief Creates a texture from a surface, first converted to the format the renderer uses natively
+		 *
+		 *  Opaque surfaces (including ones with an alpha channel which is 255 everywhere) get a texture without alpha
+		 *  and SDL_BLENDMODE_NONE. Translucent surfaces are premultiplied and get PremultipliedBlendMode() if the renderer
+		 *  supports it, otherwise they keep straight alpha and SDL_BLENDMODE_BLEND.
+		 *
+		 *  SDL_BLENDMODE_NONE ignores the alpha mod, so fading an opaque texture needs SDL_BLENDMODE_BLEND set for the draw
+		 *  (ParticleSystem does this for translucent particles). With the premultiplied mode the alpha mod only scales
+		 *  coverage, so the color mod has to be scaled by the same alpha.
+		 *
+		 *  \param surface the surface to copy (still owned by the caller)
+		 *  \param renderer a SDL_Renderer representing the current rendering context
+		 *
+		 *  \return the texture, or nullptr on failure
+		 */
+		SDL_Texture* CreateTexture(SDL_Surface* surface, SDL_Renderer* renderer);
+
+		/**
+		 *  \brief creates an image from the given file path, sharing the texture of any other image loaded from it
+		 *
+		 *  Because the texture is shared, a color, alpha or blend mode set on it changes every image loaded from the same file.
+		 *  The texture must not be destroyed with SDL_DestroyTexture, which would leave Image::textureCache (and the other
+		 *  images) holding a dangling pointer; it is released once the Image and every copy of it are gone.
 		 * 
 		 *  \param img_path a path to the file from which to load the image
 		 *  \param renderer a SDL_Renderer representing the current rendering context
@@ -332,174 +1034,2211 @@ namespace GFW {
 		 *  \return an Image representing the image stored in the given file
 		 */
 		Image CreateImg(string img_path, SDL_Renderer* renderer);
-	}
-
-
-	/**
-	 *  \brief Contains classes and functions for working with text
-	 */
-	namespace Text {
 
 		/**
-		 *  \brief Manages the loading and storage of fonts
+		 *  \brief Packs many images into a few large textures (pages) so that drawing them needs fewer texture switches
+		 *
+		 *  Images are added first, then Build packs them with a skyline packer and creates one texture per page.
+		 *  Images created afterwards share their page's texture and draw from their own srcRect.
 		 */
-		class FontManager {
+		class AtlasBuilder {
 		public:
-			FontManager() { DefaultPath = "./Fonts/"; }
-
 			/**
-			 *  \brief Loads the given font from a file
-			 * 
-			 *  \param fontPath the path to the font file relative to DefaultPath
-			 *  \param fsize the requested size of the loaded font
-			 *  \param fontName a user-defined name used to access the font (if unspecified will be fontPath - .ttf)
-			 *  \param style the requested style of the loaded font (should be flags of the type TTF_STYLE_*)
-			 * 
-			 *  \sa GetFont()
-			 *  \sa UnloadFont()
+			 *  \param pageSize the width and height of each page (images larger than this get a page of their own)
+			 *  \param padding the number of transparent pixels left around each image so filtering doesn't bleed between images
 			 */
-			void LoadFont(string fontPath, int fsize, string fontName = "", int style = TTF_STYLE_NORMAL);
+			AtlasBuilder(int pageSize = 2048, int padding = 1) : pageSize(pageSize), padding(padding) {}
+			AtlasBuilder(const AtlasBuilder&) = delete;
+			AtlasBuilder& operator=(const AtlasBuilder&) = delete;
+			~AtlasBuilder();
 
 			/**
-			 *  \brief Sets the root font path (DefaultPath)
-			 * 
-			 *  \param path the new path
+			 *  \brief Loads an image from a file to be packed
+			 *
+			 *  \param img_path a path to the file from which to load the image
+			 *
+			 *  \return a handle used to create the image after Build, or -1 if the file couldn't be loaded
 			 */
-			void SetDefaultPath(string path) { DefaultPath = path; }
+			int Add(string img_path);
 
 			/**
-			 *  \brief Unloads the given font from SDL_TTF
-			 * 
-			 *  \param fontName the fontName of the font to unload
-			 * 
-			 *  \sa LoadFont()
+			 *  \brief Adds a copy of the given surface to be packed
+			 *
+			 *  \param surface the surface to copy (still owned by the caller)
+			 *
+			 *  \return a handle used to create the image after Build, or -1 on failure
 			 */
-			void UnloadFont(string fontName) { TTF_CloseFont(GetFont(fontName)); regF.erase(fontName); }
-			
+			int Add(SDL_Surface* surface);
+
 			/**
-			 *  \return the font with the given fontName
-			 * 
-			 *  \sa LoadFont()
+			 *  \brief Packs every added image and creates the page textures
+			 *
+			 *  \param renderer a SDL_Renderer representing the current rendering context
 			 */
-			TTF_Font* GetFont(string fontName) { return regF[fontName]; }
+			void Build(SDL_Renderer* renderer);
 
 			/**
-			 *  \return the font with the given fontName
+			 *  \brief Creates an Image which draws the given packed image from its page
 			 *
-			 *  \sa LoadFont()
+			 *  \param handle a handle returned by Add
+			 *
+			 *  \return an Image with its texture, srcRect and size set
 			 */
-			TTF_Font* operator[](string fontName) { return GetFont(fontName);  }
+			Image CreateImg(int handle);
+
+			/**
+			 *  \return the page textures created by Build
+			 */
+			const vector<SDL_Texture*>& GetPages() { return pages; }
+
+			/**
+			 *  \brief Destroys the page textures (must be called before the renderer which created them is destroyed)
+			 */
+			void Destroy();
 
 		private:
-			map<string, TTF_Font*> regF;
-			string DefaultPath;
+			struct Entry {
+				SDL_Surface* surface;
+				int page;
+				SDL_Rect rect;
+			};
+
+			int pageSize;
+			int padding;
+			vector<Entry> entries;
+			vector<SDL_Texture*> pages;
 		};
 
 		/**
-		 *  \brief Represents a renderable string of text
+		 *  \brief One frame of an animation: the part of the sheet it shows and for how long
 		 */
-		struct Text : Points::Polygon, Drawable, Updatable {
+		struct Frame {
+			SDL_Rect src;
 			/**
-			 *  \brief The text which will be rendered
+			 *  \brief The number of milliseconds the frame is shown for
 			 */
-			string msg;
+			Uint32 duration;
+		};
+
+		/**
+		 *  \brief A single texture holding the frames of many animations, each a list of source rects
+		 *
+		 *  Images animated from a sheet all draw from its one texture and only their srcRect changes, so a sheet replaces
+		 *  a texture (and an Image) per frame. Advance moves every playing Image in one loop over the sheet's players.
+		 */
+		class SpriteSheet {
+		public:
+			SpriteSheet() {}
+			SpriteSheet(const SpriteSheet&) = delete;
+			SpriteSheet& operator=(const SpriteSheet&) = delete;
+
 			/**
-			 *  \brief A Vector2D representing the top-left corner of where the text will be rendered
+			 *  \brief Loads the texture holding the frames through Image::textureCache, sharing it with Images from the same file
+			 *
+			 *  \param img_path a path to the file from which to load the sheet
+			 *  \param renderer a SDL_Renderer representing the current rendering context
+			 *
+			 *  \return false if the file couldn't be loaded
 			 */
-			Vector2D pos;
+			bool Load(string img_path, SDL_Renderer* renderer);
+
 			/**
-			 *  \brief The font which will be used to render the text
+			 *  \brief Adds an animation made of equally sized cells, counted left to right and top to bottom
+			 *
+			 *  \param cellW the width of each cell
+			 *  \param cellH the height of each cell
+			 *  \param first the index of the first cell of the animation
+			 *  \param count the number of cells in the animation
+			 *  \param duration the number of milliseconds each frame is shown for
+			 *  \param loop whether the animation starts over after its last frame, or stays on it
+			 *
+			 *  \return the id of the animation
 			 */
-			TTF_Font* font;
+			int AddGrid(int cellW, int cellH, int first, int count, Uint32 duration, bool loop = true);
+
 			/**
-			 *  \brief The color in which the text will be rendered
+			 *  \brief Adds an animation made of the given frames
+			 *
+			 *  \return the id of the animation
 			 */
-			SDL_Color color = { 0, 0, 0, 255 };
+			int AddAnimation(const vector<Frame>& frames, bool loop = true);
+
 			/**
-			 *  \brief A pair representing the width and height of this text object of the form {width, height}
+			 *  \brief Creates an Image showing the first frame of the given animation, sized to that frame
+			 */
+			Image CreateImg(int animation);
+
+			/**
+			 *  \brief Starts playing an animation on the given Image, which keeps its rect and draws each frame into it
+			 *
+			 *  The Image must stay at its address until Stop is called for it (like with DrawList)
+			 *
+			 *  \param img the Image to animate
+			 *  \param animation the id of the animation
+			 *  \param restart whether to start from the first frame if the Image is already playing this animation
+			 */
+			void Play(Image& img, int animation, bool restart = false);
+
+			/**
+			 *  \brief Stops animating the given Image, which keeps showing its current frame
+			 */
+			void Stop(Image& img);
+
+			/**
+			 *  \return whether the given Image is playing an animation which hasn't reached its end
+			 */
+			bool IsPlaying(Image& img);
+
+			/**
+			 *  \brief Moves every playing Image forward and updates the srcRect of those whose frame changed
+			 *
+			 *  \param ms the number of milliseconds which passed
+			 */
+			void Advance(Uint32 ms);
+
+			SDL_Texture* GetTexture() { return texture; }
+
+			/**
+			 *  \brief Drops the sheet's reference to its texture, which is destroyed once the Images drawing it are gone too
+			 */
+			void Destroy();
+
+		private:
+			struct Animation {
+				int first, count;
+				Uint32 length;
+				bool loop;
+			};
+
+			struct Player {
+				Image* img;
+				int animation;
+				int frame;
+				/**
+				 *  \brief The time since the animation started and the time at which the current frame ends
+				 */
+				Uint32 time, frameEnd;
+				bool finished;
+			};
+
+			void Seek(Player& player);
+
+			SDL_Texture* texture = nullptr;
+			TextureCache::Handle textureRef;
+			vector<Frame> frames;
+			vector<Animation> animations;
+			vector<Player> players;
+			unordered_map<Image*, size_t> playerIndex;
+		};
+	}
+
+
+	/**
+	 *  \brief Contains classes and functions for working with text
+	 */
+	namespace Text {
+
+		/**
+		 *  \brief Manages the loading and storage of fonts
+		 */
+		class FontManager {
+		public:
+			FontManager() { DefaultPath = "./Fonts/"; }
+
+			/**
+			 *  \brief Loads the given font from a file
+			 * 
+			 *  \param fontPath the path to the font file relative to DefaultPath
+			 *  \param fsize the requested size of the loaded font
+			 *  \param fontName a user-defined name used to access the font (if unspecified will be fontPath - .ttf)
+			 *  \param style the requested style of the loaded font (should be flags of the type TTF_STYLE_*)
+			 * 
+			 *  \sa GetFont()
+			 *  \sa UnloadFont()
+			 */
+			void LoadFont(string fontPath, int fsize, string fontName = "", int style = TTF_STYLE_NORMAL);
+
+			/**
+			 *  \brief Sets the root font path (DefaultPath)
+			 * 
+			 *  \param path the new path
+			 */
+			void SetDefaultPath(string path) { DefaultPath = path; }
+
+			/**
+			 *  \brief Unloads the given font from SDL_TTF
+			 * 
+			 *  \param fontName the fontName of the font to unload
+			 * 
+			 *  \sa LoadFont()
+			 */
+			void UnloadFont(string fontName) { TTF_CloseFont(GetFont(fontName)); regF.erase(fontName); }
+			
+			/**
+			 *  \return the font with the given fontName
+			 * 
+			 *  \sa LoadFont()
+			 */
+			TTF_Font* GetFont(string fontName) { return regF[fontName]; }
+
+			/**
+			 *  \return the font with the given fontName
+			 *
+			 *  \sa LoadFont()
+			 */
+			TTF_Font* operator[](string fontName) { return GetFont(fontName);  }
+
+		private:
+			map<string, TTF_Font*> regF;
+			string DefaultPath;
+		};
+
+		/**
+		 *  \brief Represents a renderable string of text
+		 */
+		struct Text : Points::Polygon, Drawable, Updatable {
+			/**
+			 *  \brief The text which will be rendered
+			 */
+			string msg;
+			/**
+			 *  \brief A Vector2D representing the top-left corner of where the text will be rendered
+			 */
+			Vector2D pos;
+			/**
+			 *  \brief The font which will be used to render the text
+			 */
+			TTF_Font* font;
+			/**
+			 *  \brief The color in which the text will be rendered
+			 */
+			SDL_Color color = { 0, 0, 0, 255 };
+			/**
+			 *  \brief A pair representing the width and height of this text object of the form {width, height}
 			 */
 			pair<int, int> size;
 			/**
-			 *  \brief A SDL_Texture containing the rendered text
+			 *  \brief A SDL_Texture containing the rendered text
+			 */
+			SDL_Texture* texture = nullptr;
+			/**
+			 *  \brief The angle at which the text will be rendered
+			 */
+			double angle = 0;
+
+			/**
+			 *  \return The width and hight of this Text as a std::pair of the form { width, height }
+			 */
+			pair<int, int> GetTextSize() { return size; }
+
+			Points::Points GetBounds();
+
+			Collision::AnyShape GetShape();
+
+			/**
+			 *  \brief Renders this Text onto the given renderer
+			 *
+			 *  \param renderer the SDL_Renderer on which to render this Text
+			 */
+			void Draw(SDL_Renderer* renderer);
+
+			Render::RenderState GetRenderState() { Render::RenderState state; state.texture = texture; return state; }
+
+			bool GetDrawRect(SDL_Rect& rect);
+
+			void DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera);
+
+			bool Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera);
+
+			/**
+			 *  \brief Re-renderes the text onto the texture member
+			 *
+			 *  \param renderer a SDL_Renderer representing the current rendering context
+			 */
+			void DoUpdate(SDL_Renderer* renderer);
+		};
+
+	}
+
+	/**
+	 *  \brief Contains classes for working with circles
+	 */
+	namespace Circle {
+		/**
+		 *  \brief Appends the horizontal spans covering a circle to the given vector, using integer math only
+		 *
+		 *  \param spans the vector to which the spans (one pixel high SDL_Rects) are appended
+		 *  \param center the center of the circle
+		 *  \param r the radius of the circle
+		 *  \param filled whether to cover the whole circle (true) or only its one pixel outline (false)
+		 */
+		void CircleSpans(vector<SDL_Rect>& spans, Vector2D center, int r, bool filled);
+
+		/**
+		 *  \brief Stores pre-rendered circle textures shared by all Circles with the same radius, color and fill
+		 *
+		 *  The least recently used textures are destroyed once the textures take up more than the memory budget
+		 *
+		 *  \sa Circle::cached
+		 */
+		class SpriteCache {
+		public:
+			SpriteCache() { budget = 16 * 1024 * 1024; }
+
+			/**
+			 *  \brief Returns the texture for the given circle, rendering it first if it is not already cached
+			 *
+			 *  \param renderer the SDL_Renderer which will draw the texture
+			 *  \param r the radius of the circle
+			 *  \param color the color of the circle
+			 *  \param filled whether the circle is filled or only an outline
+			 *
+			 *  \return a texture of size (2 * r + 1) x (2 * r + 1) with the circle centered in it, or nullptr on failure
+			 */
+			SDL_Texture* Acquire(SDL_Renderer* renderer, int r, SDL_Color color, bool filled);
+
+			/**
+			 *  \brief Sets the maximum number of bytes of texture memory kept by this cache
+			 *
+			 *  \param bytes the new budget
+			 */
+			void SetBudget(size_t bytes) { budget = bytes; Evict(); }
+
+			/**
+			 *  \brief Destroys every cached texture (must be called before the renderer which drew them is destroyed)
+			 */
+			void Clear();
+
+			/**
+			 *  \return the number of bytes of texture memory currently used by this cache
+			 */
+			size_t GetUsage() { return usage; }
+
+			/**
+			 *  \return the number of calls to Acquire which found their texture in the cache
+			 */
+			Uint64 GetHits() { return hits; }
+
+			/**
+			 *  \return the number of calls to Acquire which had to render a new texture
+			 */
+			Uint64 GetMisses() { return misses; }
+
+		private:
+			struct Key {
+				SDL_Renderer* renderer;
+				int r;
+				Uint32 color;
+				bool filled;
+				bool operator<(const Key& o) const { return tie(renderer, r, color, filled) < tie(o.renderer, o.r, o.color, o.filled); }
+			};
+			struct Entry {
+				Key key;
+				SDL_Texture* texture;
+				size_t bytes;
+			};
+
+			void Evict();
+
+			/**
+			 *  \brief The cached textures, most recently used first
+			 */
+			list<Entry> lru;
+			map<Key, list<Entry>::iterator> entries;
+			size_t budget;
+			size_t usage = 0;
+			Uint64 hits = 0;
+			Uint64 misses = 0;
+		};
+
+		/**
+		 *  \brief Represents a circle
+		 */
+		struct Circle : Points::Polygon, Drawable, Updatable {
+			/**
+			 *  \brief A Vector2D representing the center of this Circle
+			 */
+			Vector2D pos;
+			/**
+			 *  \brief The radius of this Circle
+			 */
+			int r;
+			/**
+			 *  \brief The SDL_Color in which this Circle will be rendered
+			 */
+			SDL_Color color = { 0, 0, 0, 255 };
+			/**
+			 *  \brief Whether this Circle is drawn filled (true) or as a one pixel outline (false)
+			 */
+			bool filled = true;
+			/**
+			 *  \brief Whether this Circle is drawn by copying a texture from spriteCache instead of rasterizing it every time
+			 */
+			bool cached = false;
+			/**
+			 *  \brief A Points object containing a polygon which approximates the bounding box of the Circle
+			 */
+			Points::Points BoundingBox;
+
+			Points::Points GetBounds() { return BoundingBox; }
+
+			Collision::AnyShape GetShape();
+
+			/**
+			 *  \brief Draws this circle onto the given renderer
+			 *
+			 *  \param renderer the SDL_Renderer on which to render this circle
+			 */
+			void Draw(SDL_Renderer* renderer);
+
+			Render::RenderState GetRenderState() { Render::RenderState state; state.color = color; state.version = filled | cached << 1; return state; }
+
+			bool GetDrawRect(SDL_Rect& rect);
+
+			void DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera);
+
+			bool Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera);
+
+			/**
+			 *  \brief Updates the BoundingBox of this circle to reflect the current position and radius
+			 */
+			void DoUpdate(SDL_Renderer* renderer);
+
+			/**
+			 *  \brief A common SpriteCache for all Circles with cached set
+			 */
+			static SpriteCache spriteCache;
+
+		private:
+			void DrawAt(SDL_Renderer* renderer, Vector2D center, int radius);
+		};
+	}
+
+	/**
+	 *  \brief Contains classes for drawing pixel by pixel on the CPU
+	 */
+	namespace Canvas {
+		/**
+		 *  \brief An image whose pixels are kept in memory and changed directly, for procedural content such as heatmaps and trails
+		 *
+		 *  Changes are uploaded to a streaming texture when the Canvas is updated, only the rows which were changed are uploaded.
+		 *  Pixels are in SDL_PIXELFORMAT_ARGB8888.
+		 *
+		 *  \sa CreateCanvas()
+		 */
+		struct Canvas : Drawable, Updatable {
+			/**
+			 *  \brief The SDL_Texture which the pixels are uploaded to
+			 */
+			SDL_Texture* texture = nullptr;
+			/**
+			 *  \brief The rect in which this Canvas is drawn
+			 */
+			SDL_Rect rect = { 0, 0, 0, 0 };
+
+			int GetWidth() { return w; }
+			int GetHeight() { return h; }
+
+			/**
+			 *  \return the pixels of this Canvas, GetWidth() per row (call MarkDirty after changing them)
+			 */
+			Uint32* GetPixels() { return pixels.data(); }
+
+			/**
+			 *  \return the first pixel of the given row
+			 */
+			Uint32* GetRow(int y) { return pixels.data() + static_cast<size_t>(y) * w; }
+
+			/**
+			 *  \brief Marks the rows [y0, y1) as changed so they are uploaded by the next update
+			 */
+			void MarkDirty(int y0, int y1);
+
+			/**
+			 *  \return the given color as a pixel of this Canvas
+			 */
+			static Uint32 MapColor(SDL_Color color) { return static_cast<Uint32>(color.a) << 24 | color.r << 16 | color.g << 8 | color.b; }
+
+			/**
+			 *  \brief Replaces every pixel with the given color
+			 */
+			void Clear(SDL_Color color) { Fill({ 0, 0, w, h }, color); }
+
+			/**
+			 *  \brief Replaces the pixels in the given area (clipped to this Canvas) with the given color
+			 */
+			void Fill(const SDL_Rect& area, SDL_Color color);
+
+			/**
+			 *  \brief Blends the given color over the pixels in the given area (clipped to this Canvas)
+			 *
+			 *  Blending is a straight alpha "over", so the pixels stay straight alpha and translucent ones build up their alpha.
+			 */
+			void Blend(const SDL_Rect& area, SDL_Color color);
+
+			void SetPixel(int x, int y, SDL_Color color);
+			void BlendPixel(int x, int y, SDL_Color color);
+
+			/**
+			 *  \brief Copies a block of ARGB8888 pixels into this Canvas (clipped to this Canvas)
+			 *
+			 *  \param src the pixels to copy, srcW per row
+			 *  \param x the column at which the block's left edge is placed
+			 *  \param y the row at which the block's top edge is placed
+			 *  \param blend whether the block is blended over the current pixels instead of replacing them
+			 */
+			void Blit(const Uint32* src, int srcW, int srcH, int x, int y, bool blend = false);
+
+			/**
+			 *  \brief Draws this Canvas as it was at its last update
+			 *
+			 *  \param renderer the SDL_Renderer on which to draw
+			 */
+			void Draw(SDL_Renderer* renderer);
+
+			Render::RenderState GetRenderState() { Render::RenderState state; state.texture = texture; state.version = GetUpdateCount(); return state; }
+
+			bool GetDrawRect(SDL_Rect& r) { r = rect; return texture != nullptr; }
+
+			void DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera);
+
+			bool Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera);
+
+			/**
+			 *  \brief Destroys the texture of this Canvas, must be called before the renderer is destroyed
+			 */
+			void Destroy();
+
+			/**
+			 *  \brief Uploads the rows changed since the last update
+			 */
+			void DoUpdate(SDL_Renderer* renderer);
+
+		private:
+			friend Canvas CreateCanvas(int w, int h, SDL_Renderer* renderer);
+
+			vector<Uint32> pixels;
+			int w = 0, h = 0;
+			/**
+			 *  \brief The changed rows [dirtyTop, dirtyBottom) which haven't been uploaded yet
+			 */
+			int dirtyTop = 0, dirtyBottom = 0;
+		};
+
+		/**
+		 *  \brief Creates a transparent Canvas of the given size, drawn at its own size at (0, 0)
+		 *
+		 *  \param w the width in pixels
+		 *  \param h the height in pixels
+		 *  \param renderer a SDL_Renderer representing the current rendering context
+		 *
+		 *  \return the Canvas, or one without a texture if it couldn't be created
+		 */
+		Canvas CreateCanvas(int w, int h, SDL_Renderer* renderer);
+	}
+
+	/**
+	 *  \brief Contains classes for simulating and drawing large numbers of particles
+	 */
+	namespace Particles {
+		/**
+		 *  \brief The starting state of an emitted particle
+		 */
+		struct Particle {
+			float x, y;
+			float vx, vy;
+			/**
+			 *  \brief The number of seconds the particle lives for
+			 */
+			float lifetime;
+			SDL_Color color;
+		};
+
+		/**
+		 *  \brief A fixed-capacity pool of particles stored as one array per member, so updates are plain loops over floats
+		 *
+		 *  Live particles are kept packed at the front of the arrays, a dying particle is replaced by the last live one.
+		 *  Particles are drawn as squares (or copies of texture) in one batch per color.
+		 */
+		class ParticleSystem : public Drawable {
+		public:
+			/**
+			 *  \param capacity the largest number of particles alive at once
+			 */
+			ParticleSystem(int capacity);
+
+			/**
+			 *  \brief The acceleration applied to every particle, in world units per second squared
+			 */
+			float gravityX = 0, gravityY = 0;
+			/**
+			 *  \brief The width and height of each particle
+			 */
+			int size = 2;
+			/**
+			 *  \brief Whether particles fade out over their lifetime
+			 */
+			bool fade = true;
+			/**
+			 *  \brief A texture which is drawn for each particle, modulated by its color, or nullptr to draw squares
+			 */
+			SDL_Texture* texture = nullptr;
+
+			/**
+			 *  \brief Adds a particle
+			 *
+			 *  \return false if the system is full
+			 */
+			bool Emit(const Particle& particle);
+
+			/**
+			 *  \brief Moves every particle and removes the ones which have died
+			 *
+			 *  \param dt the number of seconds which passed
+			 *  \param threads the largest number of chunks to split the particles into on WorkerPool::Shared(), 0 for one per thread
+			 */
+			void Advance(float dt, int threads = 0);
+
+			int GetCount() { return count; }
+			int GetCapacity() { return capacity; }
+			void Clear() { count = 0; }
+
+			void Draw(SDL_Renderer* renderer);
+			void DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera);
+			bool Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera);
+
+			Render::RenderState GetRenderState() { Render::RenderState state; state.texture = texture; state.version = steps; return state; }
+
+			/**
+			 *  \return the area covered by the particles after the last Advance, empty when there are none
+			 */
+			bool GetDrawRect(SDL_Rect& rect) { rect = count > 0 ? bounds : SDL_Rect{ 0, 0, 0, 0 }; return true; }
+
+		private:
+			struct Bucket {
+				SDL_Color color;
+				vector<SDL_Rect> rects;
+			};
+
+			void Integrate(int begin, int end, float dt);
+			void Kill(int index);
+			void FillBuckets(const Render::Camera* camera);
+			void DrawBuckets(SDL_Renderer* renderer, double angle);
+
+			int capacity, count = 0;
+			vector<float> x, y, vx, vy, age, lifetime;
+			vector<SDL_Color> color;
+			SDL_Rect bounds = { 0, 0, 0, 0 };
+			Uint32 steps = 0;
+
+			/**
+			 *  \brief The particles to draw grouped by color, rebuilt every frame (the rect arrays are reused)
+			 */
+			vector<Bucket> buckets;
+			unordered_map<Uint32, size_t> bucketIndex;
+		};
+	}
+
+	/**
+	 *  \brief Contains classes for levels made of tiles
+	 */
+	namespace Tilemap {
+		/**
+		 *  \brief A grid of tiles stored in square chunks, each of which is pre-rendered into its own texture
+		 *
+		 *  Tile 0 is empty, tile n is the n-th tile of the tileset (counting from 1, left to right and top to bottom).
+		 *  Tile coordinates may be negative, chunks are only allocated where tiles are set.
+		 *  Only the chunks within the view are drawn, and a chunk is only re-rendered after its tiles change.
+		 */
+		class Tilemap : public Drawable {
+		public:
+			/**
+			 *  \param tileW the width of a tile in world units
+			 *  \param tileH the height of a tile in world units
+			 *  \param chunkTiles the width and height of a chunk in tiles
+			 */
+			Tilemap(int tileW, int tileH, int chunkTiles = 16) : tileW(tileW), tileH(tileH), chunkTiles(chunkTiles) {}
+
+			/**
+			 *  \brief Sets the texture which the tiles are copied from
+			 *
+			 *  \param texture a texture of tileW x tileH tiles without spacing
+			 *  \param columns the number of tiles in each row of the texture
+			 */
+			void SetTileset(SDL_Texture* texture, int columns);
+
+			/**
+			 *  \brief Sets whether tiles with the given id are solid when they are placed
+			 */
+			void SetTileSolid(Uint16 id, bool solid);
+
+			/**
+			 *  \brief Places a tile, its solidity is taken from SetTileSolid
+			 */
+			void SetTile(int tx, int ty, Uint16 id);
+			Uint16 GetTile(int tx, int ty);
+
+			/**
+			 *  \brief Overrides the solidity of a single tile
+			 */
+			void SetSolid(int tx, int ty, bool solid);
+
+			/**
+			 *  \return whether the given tile is solid, a hash lookup and a bit test
+			 */
+			bool IsSolid(int tx, int ty);
+
+			/**
+			 *  \return whether the tile containing the given world position is solid
+			 */
+			bool IsSolidAt(Vector2D world) { return IsSolid(FloorDiv(world.x, tileW), FloorDiv(world.y, tileH)); }
+
+			/**
+			 *  \return whether any tile overlapping the given world area is solid
+			 */
+			bool Overlaps(const SDL_Rect& area);
+
+			/**
+			 *  \brief Draws the chunks within the renderer's output
+			 *
+			 *  \param renderer the SDL_Renderer on which to draw
+			 */
+			void Draw(SDL_Renderer* renderer);
+
+			/**
+			 *  \brief Draws the chunks within the camera's view
+			 */
+			void DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera);
+
+			bool Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera);
+
+			Render::RenderState GetRenderState() { Render::RenderState state; state.texture = tileset; state.version = version; return state; }
+
+			/**
+			 *  \return the world area covered by the allocated chunks
+			 */
+			bool GetDrawRect(SDL_Rect& rect);
+
+			/**
+			 *  \return the number of chunk textures rendered so far
+			 */
+			int GetRenderCount() { return renderCount; }
+
+			/**
+			 *  \brief Destroys the chunk textures, must be called before the renderer is destroyed
+			 */
+			void Destroy();
+
+		private:
+			struct Chunk {
+				vector<Uint16> tiles;
+				/**
+				 *  \brief One bit per tile, row by row
+				 */
+				vector<Uint32> solid;
+				SDL_Texture* texture = nullptr;
+				bool dirty = true;
+			};
+
+			static int FloorDiv(int v, int d) { return v >= 0 ? v / d : -((-v + d - 1) / d); }
+			static Sint64 ChunkKey(int cx, int cy) { return static_cast<Sint64>(cx) << 32 | static_cast<Uint32>(cy); }
+
+			Chunk* FindChunk(int tx, int ty, int& index);
+			Chunk& GetChunk(int tx, int ty, int& index);
+			void DrawView(SDL_Renderer* renderer, const SDL_Rect& view, const Render::Camera* camera);
+			void RenderChunk(SDL_Renderer* renderer, Chunk& chunk);
+
+			int tileW, tileH, chunkTiles;
+			SDL_Texture* tileset = nullptr;
+			int tilesetColumns = 1;
+			vector<bool> solidIds;
+			unordered_map<Sint64, Chunk> chunks;
+			Uint32 version = 0;
+			int renderCount = 0;
+		};
+	}
+
+	/**
+	 *  \brief Contains classes for lights which are blocked by Points::Polygon bounds
+	 */
+	namespace Lighting {
+		/**
+		 *  \brief A point light whose brightness falls off to nothing at its radius
+		 */
+		struct Light {
+			Vector2D pos;
+			int radius;
+			/**
+			 *  \brief The color of the light, its alpha scales the brightness
+			 */
+			SDL_Color color;
+		};
+
+		/**
+		 *  \brief Computes the area visible from a point by sweeping a ray around it in order of angle
+		 *
+		 *  Rays are only cast towards the ends of walls (and just past them on either side), each against the walls
+		 *  which are open at its angle.
+		 *
+		 *  \param origin the point to look from
+		 *  \param radius half the width of the square the view is limited to
+		 *  \param walls pairs of points, each pair is the two ends of one wall
+		 *  \param polygon cleared and then filled with the outline of the visible area, in order of angle around origin
+		 */
+		void ComputeVisibility(Vector2D origin, int radius, const vector<Vector2D>& walls, vector<Vector2D>& polygon);
+
+		/**
+		 *  \brief Darkens everything drawn before it to the ambient color, except where its lights reach
+		 *
+		 *  Each light keeps its visibility polygon and its mask (the falloff cut to that polygon) until an occluder
+		 *  within its radius moves, so still lights cost one copy per frame. Lights outside the view are not updated.
+		 *  The masks are added up in a texture the size of the render target, which is then multiplied onto it.
+		 *  The software renderer gets the same image, added up on the CPU and multiplied onto its framebuffer.
+		 */
+		class LightMap : public Drawable {
+		public:
+			/**
+			 *  \brief The color of unlit areas
+			 */
+			SDL_Color ambient = { 0, 0, 0, 255 };
+
+			/**
+			 *  \brief Adds a Polygon whose bounds block light, it must outlive this LightMap or be removed first
+			 *
+			 *  An occluder which is also an Updatable (like Image and Circle) is only read again after it was updated,
+			 *  any other one is compared with its last bounds every frame.
+			 */
+			void AddOccluder(Points::Polygon& occluder);
+			void RemoveOccluder(Points::Polygon& occluder);
+
+			/**
+			 *  \return the id of the new light
+			 */
+			int AddLight(const Light& light);
+			void SetLight(int id, const Light& light);
+			const Light& GetLight(int id) { return lights[id].light; }
+			void RemoveLight(int id);
+
+			/**
+			 *  \brief Reads the bounds of the occluders which may have moved and invalidates the lights in range of the ones which did, called by Draw
+			 */
+			void Refresh();
+
+			/**
+			 *  \return the area lit by the given light, computed again only if it was invalidated
+			 */
+			const vector<Vector2D>& GetVisibility(int id);
+
+			/**
+			 *  \return the number of visibility polygons computed so far
+			 */
+			Uint32 GetComputeCount() { return computeCount; }
+
+			void Draw(SDL_Renderer* renderer);
+			void DrawTransformed(SDL_Renderer* renderer, const Render::Camera& camera);
+			bool Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera);
+
+			/**
+			 *  \return the state with the ambient color, versioned by every mask computed and every light changed
+			 */
+			Render::RenderState GetRenderState()
+			{
+				Render::RenderState state;
+				state.texture = target;
+				state.blendMode = SDL_BLENDMODE_MOD;
+				state.color = ambient;
+				state.version = computeCount + lightChanges;
+				return state;
+			}
+
+			/**
+			 *  \brief Destroys the mask and light textures, must be called before the renderer is destroyed
+			 */
+			void Destroy();
+
+		private:
+			struct LightEntry {
+				Light light;
+				bool used = true;
+				bool dirty = true;
+				bool maskDirty = true;
+				vector<Vector2D> visibility;
+				vector<Uint32> mask;
+				SDL_Texture* texture = nullptr;
+				int textureSize = 0;
+			};
+
+			struct Occluder {
+				Points::Polygon* polygon;
+				/**
+				 *  \brief The polygon as an Updatable, or nullptr if it isn't one
+				 */
+				Updatable* updatable;
+				Uint32 updateCount;
+				vector<Vector2D> v;
+				/**
+				 *  \brief The area covered by v, with edges inclusive
+				 */
+				SDL_Rect box;
+			};
+
+			static SDL_Rect LightRect(const Light& light) { return { light.pos.x - light.radius, light.pos.y - light.radius, light.radius * 2 + 1, light.radius * 2 + 1 }; }
+
+			void Invalidate(const SDL_Rect& area);
+			void ReadBounds(Occluder& occluder);
+			void Compute(LightEntry& entry);
+			void Composite(SDL_Renderer* renderer, const Render::Camera* camera);
+			const vector<Uint8>& GetFalloff(int radius);
+
+			vector<LightEntry> lights;
+			vector<int> freeLights;
+			vector<Occluder> occluders;
+			/**
+			 *  \brief The brightness at each squared distance from a light, by radius
+			 */
+			unordered_map<int, vector<Uint8>> falloffs;
+			SDL_Texture* target = nullptr;
+			int targetW = 0, targetH = 0;
+			/**
+			 *  \brief The light added up by Rasterize, which the software renderer reads until its frame is rasterized
+			 */
+			vector<Uint32> lightPixels;
+			Uint32 computeCount = 0;
+			/**
+			 *  \brief The number of lights added, changed or removed
+			 */
+			Uint32 lightChanges = 0;
+		};
+	}
+
+	namespace Render {
+		/**
+		 *  \brief Copies of the Images, Texts, Circles and Points submitted for a deferred draw
+		 *
+		 *  A deferred draw of a copy shows the object as it was when it was submitted, so an object which is moved and
+		 *  drawn again in the same frame appears in every place it was drawn. The copies are reused from frame to frame
+		 *  so their storage isn't reallocated.
+		 */
+		class SnapshotPool {
+		public:
+			/**
+			 *  \return a copy of the given Drawable if it is exactly an Image, Text, Circle or Points, otherwise the Drawable
+			 *  itself (which must then stay alive and unchanged until it is drawn)
+			 */
+			Drawable& Take(Drawable& drawable);
+
+			/**
+			 *  \return a copy of the given Points
+			 */
+			Points::Points& Take(const Points::Points& points);
+
+			/**
+			 *  \brief Hands the copies out again, the references returned so far must no longer be used
+			 */
+			void Reset();
+
+		private:
+			template<typename T>
+			struct Slots {
+				deque<T> items;
+				size_t used = 0;
+
+				T& Copy(const T& from);
+			};
+
+			Slots<Image::Image> images;
+			Slots<Text::Text> texts;
+			Slots<Circle::Circle> circles;
+			Slots<Points::Points> points;
+		};
+
+		/**
+		 *  \brief Counts of the work done by a RenderQueue during one frame
+		 */
+		struct RenderQueueStats {
+			/**
+			 *  \brief The number of draws which were queued
+			 */
+			int commands = 0;
+			/**
+			 *  \brief The number of times consecutive draws used a different texture, blend mode or color
+			 */
+			int stateChanges = 0;
+			/**
+			 *  \brief The number of times the queue was flushed
+			 */
+			int flushes = 0;
+		};
+
+		/**
+		 *  \brief Collects draws and performs them by layer, grouping draws which share a texture, blend mode and color
+		 *
+		 *  A draw is only moved ahead of earlier draws in its layer whose draw rects it doesn't overlap, so overlapping
+		 *  draws are always performed in the order they were pushed. A draw without a draw rect is never moved past,
+		 *  and a layer marked as ordered is never reordered at all.
+		 *
+		 *  \sa Inst::EnableRenderQueue()
+		 */
+		class RenderQueue {
+		public:
+			/**
+			 *  \brief Queues the given Drawable, copying it if SnapshotPool can (any other Drawable must stay alive until the next Flush)
+			 *
+			 *  \param drawable the Drawable to draw
+			 *  \param layer the layer in which to draw it (lower layers are drawn first)
+			 */
+			void Push(Drawable& drawable, int layer);
+
+			/**
+			 *  \brief Queues a copy of the given Points
+			 *
+			 *  \param bounds the Points to draw
+			 *  \param layer the layer in which to draw them (lower layers are drawn first)
+			 */
+			void Push(const Points::Points& bounds, int layer);
+
+			/**
+			 *  \brief Sorts and performs every queued draw, then empties the queue
+			 *
+			 *  \param renderer the SDL_Renderer on which to draw
+			 *  \param camera the camera through which to draw, or nullptr to draw in screen coordinates
+			 */
+			void Flush(SDL_Renderer* renderer, const Camera* camera = nullptr);
+
+			/**
+			 *  \brief Sets whether draws in the given layer must be performed in the order they were pushed
+			 *
+			 *  Only needed when draw rects don't describe what a draw covers, since overlapping draws keep their order anyway.
+			 *
+			 *  \param layer the layer to change
+			 *  \param ordered true to keep the pushed order, false to allow grouping by state (the default)
+			 */
+			void SetLayerOrdered(int layer, bool ordered) { orderedLayers[layer] = ordered; }
+
+			/**
+			 *  \brief Closes the current frame's counts
+			 *
+			 *  \sa GetStats()
+			 */
+			void EndFrame() { lastStats = stats; stats = RenderQueueStats(); }
+
+			/**
+			 *  \return the counts of the last completed frame
+			 */
+			RenderQueueStats GetStats() { return lastStats; }
+
+		private:
+			struct Command {
+				int layer;
+				/**
+				 *  \brief The layer's flag, looked up by Flush
+				 */
+				bool ordered;
+				Uint32 sequence;
+				RenderState state;
+				Drawable* drawable;
+				SDL_Rect rect;
+				bool bounded;
+				/**
+				 *  \brief The next command of the same batch, or -1
+				 */
+				int next;
+			};
+
+			/**
+			 *  \brief Consecutive commands sharing a state, drawn together
+			 */
+			struct Batch {
+				RenderState state;
+				/**
+				 *  \brief The union of the draw rects of the batch's commands, only meaningful if bounded
+				 */
+				SDL_Rect bounds;
+				bool bounded;
+				int first, last;
+			};
+
+			vector<Command> commands;
+			vector<Batch> batches;
+			SnapshotPool snapshots;
+			map<int, bool> orderedLayers;
+			Uint32 sequence = 0;
+			RenderQueueStats stats, lastStats;
+		};
+
+		/**
+		 *  \brief Counts of the state changes requested through a StateTracker
+		 */
+		struct StateTrackerStats {
+			/**
+			 *  \brief The number of changes which were passed on to SDL
+			 */
+			Uint64 issued = 0;
+			/**
+			 *  \brief The number of changes which were skipped because SDL already had that state
+			 */
+			Uint64 skipped = 0;
+		};
+
+		/**
+		 *  \brief Shadows a renderer's state so that calls which would not change anything never reach SDL
+		 *
+		 *  GFW_SetRenderDrawColor and GFW_GetRenderDrawColor go through the tracker attached to their renderer, if any.
+		 *  Code which changes the renderer's state with SDL directly must call Invalidate() afterwards.
+		 *
+		 *  \sa Inst::GetStateTracker()
+		 */
+		class StateTracker {
+		public:
+			StateTracker() {}
+			StateTracker(const StateTracker&) = delete;
+			StateTracker& operator=(const StateTracker&) = delete;
+			~StateTracker() { Detach(); }
+
+			/**
+			 *  \brief Starts tracking the given renderer, whose state is treated as unknown until it is first set
+			 *
+			 *  \param renderer the SDL_Renderer to track
+			 */
+			void Attach(SDL_Renderer* renderer);
+
+			/**
+			 *  \brief Stops tracking the current renderer
+			 */
+			void Detach();
+
+			/**
+			 *  \return the StateTracker attached to the given renderer, or nullptr if it isn't tracked
+			 */
+			static StateTracker* Find(SDL_Renderer* renderer);
+
+			/**
+			 *  \brief Forgets all shadowed values, so the next change of each is passed on to SDL
+			 */
+			void Invalidate();
+
+			void SetDrawColor(SDL_Color color);
+			SDL_Color GetDrawColor();
+			void SetBlendMode(SDL_BlendMode mode);
+			void SetTarget(SDL_Texture* target);
+
+			/**
+			 *  \param rect the new clip rect, or nullptr to disable clipping
+			 */
+			void SetClipRect(const SDL_Rect* rect);
+			void SetTextureColorMod(SDL_Texture* texture, Uint8 r, Uint8 g, Uint8 b);
+			void SetTextureAlphaMod(SDL_Texture* texture, Uint8 a);
+
+			/**
+			 *  \return the counts of issued and skipped state changes since the renderer was attached
+			 */
+			StateTrackerStats GetStats() { return stats; }
+
+		private:
+			SDL_Renderer* renderer = nullptr;
+			bool colorKnown = false, blendKnown = false, targetKnown = false, clipKnown = false;
+			SDL_Color color;
+			SDL_BlendMode blendMode;
+			SDL_Texture* target;
+			bool clipEnabled;
+			SDL_Rect clip;
+			StateTrackerStats stats;
+
+			static vector<StateTracker*> attached;
+		};
+	}
+
+	namespace Render {
+		/**
+		 *  \brief Counts of the work done by a DamageTracker during one frame
+		 */
+		struct DirtyRectStats {
+			/**
+			 *  \brief The number of merged rects which were redrawn
+			 */
+			int rects = 0;
+			/**
+			 *  \brief The number of pixels covered by the redrawn rects
+			 */
+			int pixels = 0;
+			/**
+			 *  \brief The number of draws performed (a draw crossing several rects is counted once per rect)
+			 */
+			int drawn = 0;
+			/**
+			 *  \brief The number of recorded draws which didn't touch any damaged rect
+			 */
+			int skipped = 0;
+		};
+
+		/**
+		 *  \brief Finds the screen areas which changed since the last frame and redraws only the objects touching them
+		 *
+		 *  Draws are recorded each frame, an object is damaged where it was and where it is if its draw rect or render state changed,
+		 *  or if it appeared or disappeared. Objects with an unknown draw rect damage the whole screen.
+		 *  The n-th draw of an object in a frame is compared with its n-th draw in the previous frame, and the draws are
+		 *  redrawn from SnapshotPool copies, so an object drawn several times per frame is tracked and drawn once per draw.
+		 *
+		 *  \sa Inst::EnableDirtyRects()
+		 */
+		class DamageTracker {
+		public:
+			/**
+			 *  \brief Records a draw of the given Drawable, copying it if SnapshotPool can (any other Drawable must stay alive until the next Redraw)
+			 */
+			void Record(Drawable& drawable);
+
+			/**
+			 *  \brief Records a draw of a copy of the given Points, which is always treated as changed
+			 */
+			void Record(const Points::Points& bounds);
+
+			/**
+			 *  \brief Marks the given screen area to be redrawn in the next frame
+			 */
+			void Damage(const SDL_Rect& rect) { extraDamage.push_back(rect); }
+
+			/**
+			 *  \brief Marks the whole screen to be redrawn in the next frame
+			 */
+			void DamageAll() { fullDamage = true; }
+
+			/**
+			 *  \brief Clears and redraws the damaged areas of the current render target, then starts a new frame
+			 *
+			 *  \param renderer the SDL_Renderer on which to draw
+			 *  \param state the StateTracker of the renderer
+			 *  \param background the color with which damaged areas are cleared
+			 *  \param screen the full area of the render target
+			 *  \param camera the camera through which to draw, or nullptr to draw in screen coordinates
+			 *  (a camera other than the identity redraws the whole screen, since draw rects are in world coordinates)
+			 */
+			void Redraw(SDL_Renderer* renderer, StateTracker& state, SDL_Color background, SDL_Rect screen, const Camera* camera = nullptr);
+
+			/**
+			 *  \return the counts of the last redrawn frame
+			 */
+			DirtyRectStats GetStats() { return stats; }
+
+		private:
+			struct Entry {
+				/**
+				 *  \brief What is drawn, a snapshot or the recorded Drawable itself
+				 */
+				Drawable* drawable;
+				/**
+				 *  \brief The recorded Drawable, or nullptr for copied Points which are always treated as changed
+				 */
+				Drawable* source;
+				SDL_Rect rect;
+				RenderState state;
+				bool known;
+				/**
+				 *  \brief The index of the next entry of the same source in the same frame, or NoEntry
+				 */
+				size_t nextSame;
+			};
+
+			/**
+			 *  \brief The first and last entries of a source in a frame
+			 */
+			struct Chain {
+				size_t first, last;
+			};
+
+			static const size_t NoEntry = static_cast<size_t>(-1);
+
+			void Collect();
+			void Merge(const SDL_Rect& screen);
+
+			vector<Entry> current, previous;
+			unordered_map<Drawable*, Chain> currentIndex, previousIndex;
+			vector<SDL_Rect> damage, extraDamage;
+			SnapshotPool snapshots;
+			bool fullDamage = true;
+			SDL_Color lastBackground = { 0, 0, 0, 0 };
+			bool lastIdentity = true;
+			DirtyRectStats stats;
+		};
+	}
+
+	namespace Render {
+		/**
+		 *  \brief A group of Drawables which is rendered once into a texture and then drawn with a single copy per frame
+		 *
+		 *  The layer is re-rendered when Invalidate is called, or when any member which is also an Updatable has been updated
+		 *  since the layer was last rendered; a pending update only counts once it has run. The texture covers the whole
+		 *  render target and is transparent wherever no member was drawn. Its colors already carry the members' alpha, so
+		 *  it is composited with Image::PremultipliedBlendMode() where the renderer supports it. Elsewhere it is read back and
+		 *  unpremultiplied after each render, which is slow but only happens when the layer changes.
+		 *
+		 *  \sa Inst::Layer()
+		 */
+		class StaticLayer : public Drawable {
+		public:
+			StaticLayer() {}
+			StaticLayer(const StaticLayer&) = delete;
+			StaticLayer& operator=(const StaticLayer&) = delete;
+			~StaticLayer() { Destroy(); }
+
+			/**
+			 *  \brief Adds the given Drawable to the end of this layer, which must stay alive while it is in the layer
+			 */
+			void Add(Drawable& drawable);
+
+			/**
+			 *  \brief Removes the given Drawable from this layer
+			 */
+			void Remove(Drawable& drawable);
+
+			/**
+			 *  \brief Removes every Drawable from this layer
+			 */
+			void Clear() { members.clear(); Invalidate(); }
+
+			/**
+			 *  \brief Makes the next Draw re-render this layer
+			 */
+			void Invalidate() { dirty = true; }
+
+			/**
+			 *  \return the number of times this layer has been rendered into its texture
+			 */
+			Uint32 GetRenderCount() { return renderCount; }
+
+			/**
+			 *  \brief Destroys the texture of this layer (must be called before the renderer which created it is destroyed)
+			 */
+			void Destroy();
+
+			/**
+			 *  \brief Re-renders this layer if it changed, then copies it onto the given renderer
+			 *
+			 *  \param renderer the SDL_Renderer on which to draw
+			 */
+			void Draw(SDL_Renderer* renderer);
+
+			RenderState GetRenderState();
+
+			bool GetDrawRect(SDL_Rect& rect);
+
+			void DrawTransformed(SDL_Renderer* renderer, const Camera& camera);
+
+			/**
+			 *  \brief Submits every member to the software renderer, since the layer texture only exists on the GPU
+			 */
+			bool Rasterize(SoftwareRenderer& target, const Camera& camera);
+
+		private:
+			struct Member {
+				Drawable* drawable;
+				/**
+				 *  \brief The drawable as an Updatable, or nullptr if it isn't one
+				 */
+				Updatable* updatable;
+				Uint32 updateCount;
+			};
+
+			bool Changed();
+			void Render(SDL_Renderer* renderer);
+
+			vector<Member> members;
+			SDL_Texture* texture = nullptr;
+			int w = 0, h = 0;
+			/**
+			 *  \brief Whether the texture is blended with Image::PremultipliedBlendMode(), otherwise it is unpremultiplied after each render
+			 */
+			bool premultiplied = true;
+			bool dirty = true;
+			Uint32 renderCount = 0;
+		};
+
+		/**
+		 *  \brief Counts of the draws submitted to an Inst during one frame and of those skipped as offscreen
+		 */
+		struct CullStats {
+			int submitted = 0;
+			int culled = 0;
+		};
+
+		/**
+		 *  \brief A uniform grid which finds the Drawables in an area without testing every one of them
+		 *
+		 *  Each Drawable's draw rect is cached when it is inserted, so it must be passed to Update after it moves
+		 *
+		 *  \sa Inst::DrawVisible()
+		 */
+		class SpatialGrid {
+		public:
+			/**
+			 *  \param cellSize the width and height of each grid cell in world units
+			 */
+			SpatialGrid(int cellSize = 256) : cellSize(cellSize) {}
+
+			/**
+			 *  \brief Adds the given Drawable at its current draw rect (Drawables without a known draw rect are always returned)
+			 */
+			void Insert(Drawable& drawable);
+
+			/**
+			 *  \brief Removes the given Drawable
+			 */
+			void Remove(Drawable& drawable);
+
+			/**
+			 *  \brief Moves the given Drawable to its current draw rect
+			 */
+			void Update(Drawable& drawable) { Remove(drawable); Insert(drawable); }
+
+			/**
+			 *  \brief Removes every Drawable
+			 */
+			void Clear() { cells.clear(); items.clear(); unbounded.clear(); }
+
+			/**
+			 *  \brief Finds every Drawable whose cached draw rect intersects the given area
+			 *
+			 *  \param area the world area to search
+			 *  \param out cleared and then filled with the found Drawables, in the order they were inserted
+			 */
+			void Query(const SDL_Rect& area, vector<Drawable*>& out);
+
+		private:
+			struct Item {
+				SDL_Rect rect;
+				bool known;
+				Uint32 sequence;
+			};
+
+			Sint64 CellKey(int cx, int cy) { return static_cast<Sint64>(cx) << 32 | static_cast<Uint32>(cy); }
+			int CellOf(int v) { return v >= 0 ? v / cellSize : -((-v + cellSize - 1) / cellSize); }
+
+			int cellSize;
+			Uint32 sequence = 0;
+			unordered_map<Sint64, vector<Drawable*>> cells;
+			unordered_map<Drawable*, Item> items;
+			vector<Drawable*> unbounded;
+		};
+	}
+
+	namespace Render {
+		/**
+		 *  \brief A fixed set of threads which split a batch of numbered jobs with the thread that hands them out
+		 *
+		 *  The threads are only started by the first batch that can use them, and wait between batches.
+		 *  One batch runs at a time, so a job must not start another batch on the same pool.
+		 */
+		class WorkerPool {
+		public:
+			/**
+			 *  \param threads the number of threads running jobs, including the one calling Run, 0 for one per core
+			 */
+			WorkerPool(int threads = 0);
+			WorkerPool(const WorkerPool&) = delete;
+			WorkerPool& operator=(const WorkerPool&) = delete;
+			~WorkerPool();
+
+			/**
+			 *  \return the pool shared by everything which wasn't given its own thread count, one thread per core
+			 */
+			static WorkerPool& Shared();
+
+			/**
+			 *  \brief Calls job with every number from 0 to count - 1, spread across the threads, and returns once all are done
+			 */
+			void Run(int count, const function<void(int)>& job);
+
+			/**
+			 *  \return the number of threads running jobs, including the one calling Run
+			 */
+			int GetThreads() { return threads; }
+
+		private:
+			void Drain();
+			void Work();
+
+			int threads;
+			vector<thread> workers;
+			mutex running, lock;
+			condition_variable wake, finished;
+			Uint32 generation = 0;
+			int busy = 0;
+			bool quitting = false;
+
+			/**
+			 *  \brief The batch the threads are currently working on
+			 */
+			const function<void(int)>* job = nullptr;
+			int jobs = 0;
+			atomic<int> next;
+		};
+
+		/**
+		 *  \brief Counts describing the last frame rasterized by a SoftwareRenderer
+		 */
+		struct SoftwareRasterStats {
+			/**
+			 *  \brief The number of recorded commands
+			 */
+			int commands = 0;
+			/**
+			 *  \brief The number of (command, tile) pairs rasterized, larger than commands when they span several tiles
+			 */
+			int binned = 0;
+			/**
+			 *  \brief The number of submitted Drawables which can't be drawn in software and were skipped
+			 */
+			int unsupported = 0;
+			int tiles = 0;
+			/**
+			 *  \brief The number of threads rasterizing tiles, including the one calling Present
+			 */
+			int threads = 0;
+		};
+
+		/**
+		 *  \brief Draws into a CPU framebuffer on a pool of threads, for machines where SDL falls back to its single threaded software renderer
+		 *
+		 *  Drawing commands are recorded, sorted into square screen tiles and rasterized one tile per thread at a time,
+		 *  so every pixel is written by a single thread in the order its commands were recorded.
+		 *  The finished frame is uploaded to a streaming texture once per frame.
+		 *
+		 *  Textured draws need a CPU copy of their texture, which is captured when the texture is created by GFW
+		 *  (Image::CreateImg, Text, Image::AtlasBuilder) while a SoftwareRenderer is attached to the renderer.
+		 *  Any other texture is read back from the renderer the first time it is drawn, and only shows changes made
+		 *  after that if it is captured again.
+		 *
+		 *  \sa Inst::EnableSoftwareRaster()
+		 */
+		class SoftwareRenderer {
+		public:
+			/**
+			 *  \param w the width of the framebuffer
+			 *  \param h the height of the framebuffer
+			 *  \param threads the number of threads which rasterize tiles, 0 to use WorkerPool::Shared()
+			 *  \param tileSize the width and height of each tile
+			 */
+			SoftwareRenderer(int w, int h, int threads = 0, int tileSize = 64);
+			SoftwareRenderer(const SoftwareRenderer&) = delete;
+			SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+			~SoftwareRenderer();
+
+			/**
+			 *  \brief Starts capturing the textures GFW creates on the given renderer
+			 *
+			 *  \param renderer the SDL_Renderer which the frames are presented on
+			 */
+			void Attach(SDL_Renderer* renderer);
+
+			/**
+			 *  \brief Stops capturing textures
+			 */
+			void Detach();
+
+			/**
+			 *  \return the SoftwareRenderer attached to the given renderer, or nullptr if there is none
+			 */
+			static SoftwareRenderer* Find(SDL_Renderer* renderer);
+
+			/**
+			 *  \brief Keeps a CPU copy of the given texture's pixels if a SoftwareRenderer is attached to the renderer
+			 *
+			 *  \param renderer the SDL_Renderer which created the texture
+			 *  \param texture the created texture
+			 *  \param surface the surface the texture was created from
+			 */
+			static void CaptureTexture(SDL_Renderer* renderer, SDL_Texture* texture, SDL_Surface* surface);
+
+			/**
+			 *  \brief Drops the CPU copies of the given texture, must be called before it is destroyed
+			 */
+			static void ReleaseTexture(SDL_Texture* texture);
+
+			/**
+			 *  \brief Records filling the whole framebuffer with the given color
+			 */
+			void Clear(SDL_Color color);
+
+			/**
+			 *  \brief Records drawing a captured texture like SDL_RenderCopyEx, using its color and alpha mods
+			 *
+			 *  \param texture the texture to copy, which is read back from the renderer if it wasn't captured
+			 *  \param src the area of the texture to copy, or nullptr for all of it
+			 *  \param dst the screen rect to copy into
+			 *  \param angle the angle (in degrees) by which dst is rotated clockwise around its center
+			 *  \return false if the texture wasn't captured and couldn't be read back, so nothing is drawn
+			 */
+			bool CopyEx(SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect& dst, double angle);
+
+			void FillRects(const SDL_Rect* rects, int count, SDL_Color color);
+			void DrawLines(const SDL_Point* points, int count, SDL_Color color);
+
+			/**
+			 *  \brief Records filling the given polygon (the points are a closed outline, filled with the even-odd rule)
+			 */
+			void FillPolygon(const SDL_Point* points, int count, SDL_Color color);
+
+			/**
+			 *  \brief Records multiplying the colors of the framebuffer by the given pixels, like SDL_BLENDMODE_MOD
+			 *
+			 *  \param pixels ARGB8888 pixels, area.w per row, which must stay unchanged until the frame is rasterized
+			 *  \param area the screen rect the pixels cover, one framebuffer pixel each
+			 */
+			void Modulate(const Uint32* pixels, const SDL_Rect& area);
+
+			/**
+			 *  \brief Records the given Drawable, counting it as unsupported if it can't be drawn in software
+			 */
+			void Submit(Drawable& drawable, const Camera& camera);
+
+			/**
+			 *  \brief Rasterizes every recorded command into the framebuffer and starts recording the next frame
+			 */
+			void Rasterize();
+
+			/**
+			 *  \brief Rasterizes the frame, then uploads and copies it onto the given renderer
+			 */
+			void Present(SDL_Renderer* renderer);
+
+			/**
+			 *  \return the framebuffer in SDL_PIXELFORMAT_ARGB8888, GetWidth() pixels per row
+			 */
+			const Uint32* GetPixels() { return pixels.data(); }
+			int GetWidth() { return w; }
+			int GetHeight() { return h; }
+
+			/**
+			 *  \brief Destroys the streaming texture, must be called before the renderer it was created on is destroyed
+			 */
+			void Destroy();
+
+			/**
+			 *  \return the counts of the last rasterized frame
+			 */
+			SoftwareRasterStats GetStats() { return lastStats; }
+
+		private:
+			enum CommandKind { COMMAND_CLEAR, COMMAND_RECTS, COMMAND_LINES, COMMAND_POLYGON, COMMAND_QUAD, COMMAND_MODULATE };
+
+			struct Command {
+				CommandKind kind;
+				Uint32 color;
+				SDL_Rect bounds;
+				/**
+				 *  \brief The range of rects or points used, or the index of the quad or modulation
+				 */
+				int first, count;
+			};
+
+			struct Quad {
+				SDL_Surface* surface;
+				SDL_Rect src;
+				double cx, cy, cosA, sinA, halfW, halfH;
+				Uint8 r, g, b, a;
+			};
+
+			struct Modulation {
+				const Uint32* pixels;
+				SDL_Rect area;
+			};
+
+			void Record(CommandKind kind, SDL_Color color, SDL_Rect bounds, int first, int count);
+			SDL_Surface* ReadBack(SDL_Texture* texture);
+			void RasterTile(int tile);
+
+			int w, h, tileSize, tilesX, tilesY;
+			vector<Uint32> pixels;
+			vector<Command> commands;
+			vector<SDL_Rect> rects;
+			vector<SDL_Point> points;
+			vector<Quad> quads;
+			vector<Modulation> modulations;
+			vector<vector<int>> bins;
+			map<SDL_Texture*, SDL_Surface*> surfaces;
+			SDL_Renderer* renderer = nullptr;
+			SDL_Texture* upload = nullptr;
+			SoftwareRasterStats stats, lastStats;
+
+			/**
+			 *  \brief The pool the tiles run on, ownPool if a thread count was given (its threads are only started when used)
+			 */
+			WorkerPool ownPool;
+			WorkerPool* pool;
+
+			static vector<SoftwareRenderer*> attached;
+		};
+	}
+
+	namespace Render {
+		enum CaptureFormat {
+			/**
+			 *  \brief One PNG file per frame
+			 */
+			CAPTURE_PNG,
+			/**
+			 *  \brief One file per frame holding its rows in SDL_PIXELFORMAT_ARGB8888, without a header
+			 */
+			CAPTURE_RAW
+		};
+
+		/**
+		 *  \brief Counts and timings of a FrameCapture since it was started
+		 */
+		struct FrameCaptureStats {
+			/**
+			 *  \brief The number of frames offered for capture, including dropped ones
+			 */
+			int captured = 0;
+			/**
+			 *  \brief The number of frames skipped because every buffer was still waiting to be written
+			 */
+			int dropped = 0;
+			int written = 0;
+			/**
+			 *  \brief The average time (in milliseconds) spent reading a frame back on the rendering thread
+			 */
+			double readMs = 0;
+			/**
+			 *  \brief The average time (in milliseconds) a writer thread spent encoding and writing a frame
+			 */
+			double encodeMs = 0;
+		};
+
+		/**
+		 *  \brief Records frames to disk without stalling the rendering thread
+		 *
+		 *  Frames are read back into a fixed pool of buffers which writer threads encode and save,
+		 *  when every buffer is still queued the frame is dropped instead of waiting
+		 *
+		 *  \sa Inst::StartCapture()
+		 */
+		class FrameCapture {
+		public:
+			FrameCapture() {}
+			FrameCapture(const FrameCapture&) = delete;
+			FrameCapture& operator=(const FrameCapture&) = delete;
+			~FrameCapture() { Stop(); }
+
+			/**
+			 *  \brief Starts accepting frames
+			 *
+			 *  \param pathPrefix the start of each file's path, followed by the frame number and extension
+			 *  \param format the format in which frames are written
+			 *  \param writers the number of writer threads
+			 *  \param buffers the number of frames which can wait to be written before frames are dropped
+			 */
+			void Start(string pathPrefix, CaptureFormat format = CAPTURE_PNG, int writers = 1, int buffers = 4);
+
+			/**
+			 *  \brief Writes every queued frame and stops the writer threads
+			 */
+			void Stop();
+
+			bool IsRunning() { return running; }
+
+			/**
+			 *  \brief Reads the current frame of the given renderer into a free buffer and queues it for writing
+			 *
+			 *  \param renderer the SDL_Renderer to read (before it is presented)
+			 *  \param w the width of the frame
+			 *  \param h the height of the frame
+			 *  \return false if the frame was dropped
+			 */
+			bool Capture(SDL_Renderer* renderer, int w, int h);
+
+			FrameCaptureStats GetStats();
+
+		private:
+			struct Frame {
+				vector<Uint32> pixels;
+				int w, h;
+				int number;
+			};
+
+			void Write();
+
+			string prefix;
+			CaptureFormat format = CAPTURE_PNG;
+			bool running = false;
+			int frameNumber = 0;
+
+			vector<Frame> frames;
+			vector<Frame*> freeFrames;
+			deque<Frame*> queued;
+			vector<thread> writers;
+			mutex lock;
+			condition_variable wake;
+			bool stopping = false;
+			FrameCaptureStats stats;
+			Uint64 readTicks = 0, encodeTicks = 0;
+		};
+	}
+
+	namespace Render {
+		/**
+		 *  \brief Counts describing the last frame flushed by a DebugBatch
+		 */
+		struct DebugBatchStats {
+			int outlines = 0;
+			/**
+			 *  \brief The number of straight pixel runs the outlines were broken into
+			 */
+			int runs = 0;
+			/**
+			 *  \brief The number of SDL draw calls used to draw every run
+			 */
+			int drawCalls = 0;
+		};
+
+		/**
+		 *  \brief Collects the outlines drawn during a frame and draws them with one SDL call per color
+		 *
+		 *  Each outline is broken into horizontal and vertical pixel runs which are added to the buffer of its color,
+		 *  the buffers are kept from frame to frame so collecting doesn't allocate once they have grown
+		 *
+		 *  \sa Inst::EnableDebugBatch()
+		 */
+		class DebugBatch {
+		public:
+			/**
+			 *  \brief Adds the lines between consecutive points of the given outline, like Points::Draw() draws them
+			 *
+			 *  \param outline the outline to add
+			 *  \param camera the camera through which to draw, or nullptr to draw in screen coordinates
+			 */
+			void Add(const Points::Points& outline, const Camera* camera = nullptr) { Add(outline.v.data(), static_cast<int>(outline.v.size()), outline.color, camera); }
+
+			/**
+			 *  \brief Adds the outline through the given vertices in the given color, without needing them in a Points object
+			 */
+			void Add(const Vector2D* v, int count, SDL_Color color, const Camera* camera = nullptr);
+
+			/**
+			 *  \brief Draws and removes every collected outline
+			 *
+			 *  \param renderer the SDL_Renderer on which to draw
+			 */
+			void Flush(SDL_Renderer* renderer);
+
+			/**
+			 *  \return the counts of the last flush
+			 */
+			DebugBatchStats GetStats() { return lastStats; }
+
+		private:
+			struct Batch {
+				SDL_Color color;
+				vector<SDL_Rect> runs;
+			};
+
+			vector<Batch> batches;
+			DebugBatchStats stats, lastStats;
+		};
+	}
+
+	namespace Render {
+		/**
+		 *  \brief A filter which PostProcess runs over the whole frame, split across threads by rows
+		 */
+		class PostFilter {
+		public:
+			virtual ~PostFilter() {}
+
+			/**
+			 *  \return the name under which this filter's time is reported
+			 */
+			virtual const char* GetName() = 0;
+
+			/**
+			 *  \return the number of passes, each of which reads the output of the previous one
+			 */
+			virtual int GetPasses() { return 1; }
+
+			/**
+			 *  \brief Called on the rendering thread before the passes of each frame
+			 */
+			virtual void Prepare(int w, int h) {}
+
+			/**
+			 *  \brief Filters the rows [y0, y1) of one pass, may be called from several threads at once for different rows
+			 *
+			 *  \param pass the index of the pass
+			 *  \param src the whole input frame in SDL_PIXELFORMAT_ARGB8888, w pixels per row
+			 *  \param dst the whole output frame
+			 */
+			virtual void Apply(int pass, const Uint32* src, Uint32* dst, int w, int h, int y0, int y1) = 0;
+		};
+
+		/**
+		 *  \brief Averages every pixel with its neighbours within radius, horizontally and then vertically
+		 */
+		class BoxBlur : public PostFilter {
+		public:
+			/**
+			 *  \param radius the number of neighbours on each side (at most 128)
+			 */
+			BoxBlur(int radius = 2) : radius(max(0, min(radius, 128))) {}
+
+			const char* GetName() { return "box blur"; }
+			int GetPasses() { return 2; }
+			void Apply(int pass, const Uint32* src, Uint32* dst, int w, int h, int y0, int y1);
+
+		private:
+			int radius;
+		};
+
+		/**
+		 *  \brief Blurs with a gaussian kernel, horizontally and then vertically
+		 */
+		class GaussianBlur : public PostFilter {
+		public:
+			/**
+			 *  \param sigma the standard deviation of the kernel in pixels (the kernel reaches 3 sigma, at most 64 pixels)
+			 */
+			GaussianBlur(double sigma = 1.5);
+
+			const char* GetName() { return "gaussian blur"; }
+			int GetPasses() { return 2; }
+			void Apply(int pass, const Uint32* src, Uint32* dst, int w, int h, int y0, int y1);
+
+		private:
+			/**
+			 *  \brief The weights from -radius to radius, which add up to 256
 			 */
-			SDL_Texture* texture = nullptr;
+			vector<Uint32> weights;
+			int radius;
+		};
+
+		/**
+		 *  \brief Maps each color channel through a lookup table
+		 */
+		class ColorGrade : public PostFilter {
+		public:
 			/**
-			 *  \brief The angle at which the text will be rendered
+			 *  \brief Creates a filter which leaves colors unchanged until a curve is set
 			 */
-			double angle = 0;
+			ColorGrade();
 
 			/**
-			 *  \return The width and hight of this Text as a std::pair of the form { width, height }
+			 *  \brief Fills the lookup table of a channel from a curve
+			 *
+			 *  \param channel 0 for red, 1 for green, 2 for blue or -1 for all three
+			 *  \param curve maps an input intensity from 0 to 1 to an output intensity (clamped to 0 to 1)
 			 */
-			pair<int, int> GetTextSize() { return size; }
+			void SetCurve(int channel, function<double(double)> curve);
 
-			Points::Points GetBounds();
+			const char* GetName() { return "color grade"; }
+			void Apply(int pass, const Uint32* src, Uint32* dst, int w, int h, int y0, int y1);
 
+		private:
+			Uint8 lut[3][256];
+		};
+
+		/**
+		 *  \brief Darkens the frame towards its corners
+		 */
+		class Vignette : public PostFilter {
+		public:
 			/**
-			 *  \brief Renders this Text onto the given renderer
-			 *
-			 *  \param renderer the SDL_Renderer on which to render this Text
+			 *  \param strength how dark the corners become, from 0 (unchanged) to 1 (black)
+			 *  \param start the distance from the center (relative to the corners) at which the darkening starts
 			 */
-			void Draw(SDL_Renderer* renderer);
+			Vignette(double strength = 0.5, double start = 0.5) : strength(strength), start(start) {}
 
+			const char* GetName() { return "vignette"; }
+			void Prepare(int w, int h);
+			void Apply(int pass, const Uint32* src, Uint32* dst, int w, int h, int y0, int y1);
+
+		private:
+			double strength, start;
 			/**
-			 *  \brief Re-renderes the text onto the texture member
-			 *
-			 *  \param renderer a SDL_Renderer representing the current rendering context
+			 *  \brief The brightness of each pixel from 0 to 256, rebuilt when the frame size changes
 			 */
-			void DoUpdate(SDL_Renderer* renderer);
+			vector<Uint16> mask;
+			int maskW = 0, maskH = 0;
 		};
 
-	}
+		/**
+		 *  \brief The time a PostFilter took during the last frame
+		 */
+		struct PostFilterTiming {
+			string name;
+			double ms;
+		};
 
-	/**
-	 *  \brief Contains classes for working with circles
-	 */
-	namespace Circle {
 		/**
-		 *  \brief Represents a circle
+		 *  \brief Timings of the last frame processed by a PostProcess
 		 */
-		struct Circle : Points::Polygon, Drawable, Updatable {
+		struct PostProcessStats {
 			/**
-			 *  \brief A Vector2D representing the center of this Circle
+			 *  \brief The time (in milliseconds) spent reading the frame back
 			 */
-			Vector2D pos;
+			double readMs = 0;
 			/**
-			 *  \brief The radius of this Circle
+			 *  \brief The time (in milliseconds) spent uploading and copying the result
 			 */
-			int r;
+			double uploadMs = 0;
+			vector<PostFilterTiming> filters;
+			int threads = 0;
+		};
+
+		/**
+		 *  \brief Runs a chain of filters over the finished frame on the CPU, for machines without a GPU to run shaders on
+		 *
+		 *  The frame is read back once, each pass of each filter is split across a pool of threads by rows,
+		 *  and the result is uploaded once
+		 *
+		 *  \sa Inst::AddPostFilter()
+		 */
+		class PostProcess {
+		public:
 			/**
-			 *  \brief The SDL_Color in which this Circle will be rendered
+			 *  \param threads the number of threads which filter rows, 0 to use WorkerPool::Shared()
 			 */
-			SDL_Color color = { 0, 0, 0, 255 };
+			PostProcess(int threads = 0) : ownPool(threads), pool(threads > 0 ? &ownPool : &WorkerPool::Shared()) {}
+			PostProcess(const PostProcess&) = delete;
+			PostProcess& operator=(const PostProcess&) = delete;
+
 			/**
-			 *  \brief A Points object containing a polygon which approximates the bounding box of the Circle
+			 *  \brief Appends a filter to the chain (the filter must outlive this PostProcess or be removed)
 			 */
-			Points::Points BoundingBox;
-
-			Points::Points GetBounds() { return BoundingBox; }
+			void Add(PostFilter& filter) { filters.push_back(&filter); }
+			void Remove(PostFilter& filter);
+			void Clear() { filters.clear(); }
+			bool IsEmpty() { return filters.empty(); }
 
 			/**
-			 *  \brief Draws this circle onto the given renderer
+			 *  \brief Reads the current frame of the given renderer, runs every filter and copies the result back
 			 *
-			 *  \param renderer the SDL_Renderer on which to render this circle
+			 *  \param renderer the SDL_Renderer to process (before it is presented)
+			 *  \param w the width of the frame
+			 *  \param h the height of the frame
 			 */
-			void Draw(SDL_Renderer* renderer);
+			void Apply(SDL_Renderer* renderer, int w, int h);
 
 			/**
-			 *  \brief Updates the BoundingBox of this circle to reflect the current position and radius
+			 *  \brief Destroys the upload texture, must be called before the renderer it was created on is destroyed
 			 */
-			void DoUpdate(SDL_Renderer* renderer);
+			void Destroy();
+
+			PostProcessStats GetStats() { return stats; }
+
+		private:
+			vector<PostFilter*> filters;
+			vector<Uint32> front, back;
+			SDL_Texture* upload = nullptr;
+			int uploadW = 0, uploadH = 0;
+			PostProcessStats stats;
+
+			/**
+			 *  \brief The pool the bands run on, ownPool if a thread count was given (its threads are only started when used)
+			 */
+			WorkerPool ownPool;
+			WorkerPool* pool;
 		};
 	}
 
+	/**
+	 *  \brief Draws collections of Images, Texts and Circles without a virtual call per object
+	 *
+	 *  Each type is kept in its own array and drawn in its own loop, so all Images are drawn first, then all Texts,
+	 *  then all Circles. The objects are not copied, so they must stay at the same address while they are in the list.
+	 *
+	 *  \sa Inst::Draw()
+	 */
+	class DrawList {
+	public:
+		/**
+		 *  \brief Adds the given object to the end of its type's array
+		 *
+		 *  \sa Remove()
+		 */
+		void Add(Image::Image& img) { images.push_back(&img); }
+		void Add(Text::Text& txt) { texts.push_back(&txt); }
+		void Add(Circle::Circle& circle) { circles.push_back(&circle); }
+
+		/**
+		 *  \brief Removes the given object from its type's array
+		 *
+		 *  \sa Add()
+		 */
+		void Remove(Image::Image& img) { images.erase(find(images.begin(), images.end(), &img)); }
+		void Remove(Text::Text& txt) { texts.erase(find(texts.begin(), texts.end(), &txt)); }
+		void Remove(Circle::Circle& circle) { circles.erase(find(circles.begin(), circles.end(), &circle)); }
+
+		/**
+		 *  \brief Removes every object from this list
+		 */
+		void Clear() { images.clear(); texts.clear(); circles.clear(); }
+
+		/**
+		 *  \return the number of objects in this list
+		 */
+		size_t Size() { return images.size() + texts.size() + circles.size(); }
+
+		/**
+		 *  \brief Draws every object in this list onto the given renderer, one type at a time
+		 *
+		 *  \param renderer the SDL_Renderer on which to draw
+		 *  \param camera the camera through which to draw, or nullptr to draw in screen coordinates
+		 */
+		void Draw(SDL_Renderer* renderer, const Render::Camera* camera = nullptr);
+
+		/**
+		 *  \brief Records every object in this list into the given software renderer, one type at a time
+		 *
+		 *  \param target the SoftwareRenderer which records the commands
+		 *  \param camera the camera through which to draw
+		 */
+		void Rasterize(Render::SoftwareRenderer& target, const Render::Camera& camera);
+
+		/**
+		 *  \brief Records every object in this list into the given damage tracker, one type at a time
+		 *
+		 *  \param tracker the DamageTracker which redraws the objects (they must stay alive until its next Redraw)
+		 */
+		void Record(Render::DamageTracker& tracker);
+
+	private:
+		vector<Image::Image*> images;
+		vector<Text::Text*> texts;
+		vector<Circle::Circle*> circles;
+	};
+
 
 	/**
 	 *  \brief A class representing a window instance
 	 */
 	class Inst {
 	public:
-		Inst();
+		/**
+		 *  \brief Initializes SDL and SDL_ttf
+		 *
+		 *  \param headless whether to leave out the SDL subsystems which need a display or audio device (for HeadlessInit())
+		 */
+		Inst(bool headless = false);
+
+		/**
+		 *  \brief Initializes this instance without a window, rendering into an offscreen surface through SDL's software renderer
+		 *
+		 *  The frame stays in frameSurface after pres(), so it can be read back with ReadFrame(), and Delay() doesn't wait.
+		 *  frameSurface must be freed after the renderer is destroyed.
+		 *
+		 *  \param sw the width of the frame
+		 *  \param sh the height of the frame
+		 */
+		void HeadlessInit(int sw, int sh);
+
+		/**
+		 *  \brief Copies the current frame into memory
+		 *
+		 *  With a window the frame must be read before pres(), since presenting may discard it
+		 *
+		 *  \param pixels resized to the frame size and filled with its pixels in SDL_PIXELFORMAT_ARGB8888, row by row
+		 *  \return whether the frame could be read
+		 */
+		bool ReadFrame(vector<Uint32>& pixels);
 
 		/**
 		 *  \brief Initializes this instance by creating the window and renderer
@@ -563,7 +3302,7 @@ namespace GFW {
 		 * 
 		 *  \param bounds the Points to draw
 		 */
-		void DrawBounds(Points::Points bounds) { bounds.Draw(renderer); };
+		void DrawBounds(const Points::Points& bounds);
 
 		/**
 		 *  \brief Draws the outline of the given Polygon
@@ -575,17 +3314,209 @@ namespace GFW {
 		/**
 		 *  \brief Draws the outline of the given Polygon
 		 *
+		 *  With batchBounds set, a Polygon whose shape is a rect or refers to its vertices is batched straight from them.
+		 *
 		 *  \param poly the Polygon to draw
 		 *  \param color the color in which to draw the polygon
 		 */
 		void DrawBounds(Points::Polygon& poly, SDL_Color color);
 
 		/**
-		 *  \brief Calls the draw function on the given Drawable with the current renderer
+		 *  \brief Calls the draw function on the given Drawable with the current renderer, or queues it if the render queue is enabled
 		 * 
 		 *  \param drawable the Drawable to draw
+		 * 
+		 *  \sa EnableRenderQueue()
+		 */
+		void Draw(Drawable& drawable);
+
+		/**
+		 *  \brief Draws every object in the given DrawList with the current renderer
+		 *
+		 *  If the render queue is enabled it is flushed first, so the list is still drawn after everything queued before it
+		 *
+		 *  \param list the DrawList to draw
+		 */
+		void Draw(DrawList& list);
+
+		/**
+		 *  \brief Sets whether Draw and DrawBounds queue their draws until pres() instead of drawing immediately
+		 *
+		 *  \param enable true to queue draws, false to draw immediately (the default)
+		 *
+		 *  \sa SetDrawLayer()
+		 *  \sa GetRenderQueueStats()
 		 */
-		void Draw(Drawable& drawable) { drawable.Draw(renderer); };
+		void EnableRenderQueue(bool enable) { if (!enable) FlushRenderQueue(); queueDraws = enable; }
+
+		/**
+		 *  \brief Sets the layer into which following queued draws are placed (lower layers are drawn first)
+		 *
+		 *  \param layer the new layer
+		 */
+		void SetDrawLayer(int layer) { drawLayer = layer; }
+
+		/**
+		 *  \brief Sets whether queued draws in the given layer must keep the order in which they were drawn
+		 *
+		 *  \param layer the layer to change
+		 *  \param ordered true to keep the drawn order, false to allow grouping by texture and color (the default)
+		 */
+		void SetLayerOrdered(int layer, bool ordered) { renderQueue.SetLayerOrdered(layer, ordered); }
+
+		/**
+		 *  \brief Performs every queued draw now instead of waiting for pres()
+		 */
+		void FlushRenderQueue() { renderQueue.Flush(renderer); }
+
+		/**
+		 *  \return the render queue counts of the last presented frame
+		 */
+		Render::RenderQueueStats GetRenderQueueStats() { return renderQueue.GetStats(); }
+
+		/**
+		 *  \brief Sets whether only the parts of the frame which changed are redrawn
+		 *
+		 *  In this mode Draw and DrawBounds record their draws, and pres() redraws only the objects touching damaged areas
+		 *  into a persistent target texture, which is then copied to the window. Drawing directly with SDL between prep() and pres()
+		 *  is overwritten by that copy.
+		 *
+		 *  \param enable true to redraw only damaged areas, false to redraw everything each frame (the default)
+		 *
+		 *  \sa Damage()
+		 *  \sa GetDirtyRectStats()
+		 */
+		void EnableDirtyRects(bool enable);
+
+		/**
+		 *  \brief Marks the given screen area to be redrawn in dirty rect mode (for changes the mode can't detect by itself)
+		 *
+		 *  \param rect the area to redraw
+		 */
+		void Damage(const SDL_Rect& rect) { damageTracker.Damage(rect); }
+
+		/**
+		 *  \return the dirty rect counts of the last presented frame
+		 */
+		Render::DirtyRectStats GetDirtyRectStats() { return damageTracker.GetStats(); }
+
+		/**
+		 *  \brief Returns the cached static layer with the given name, creating it if it doesn't exist (ex. Draw(Layer("background"));)
+		 *
+		 *  \param name a user-defined name used to access the layer
+		 *
+		 *  \sa Render::StaticLayer
+		 */
+		Render::StaticLayer& Layer(string name) { return layers[name]; }
+
+		/**
+		 *  \brief Makes the layer with the given name re-render the next time it is drawn
+		 *
+		 *  \param name the name of the layer
+		 */
+		void InvalidateLayer(string name) { layers[name].Invalidate(); }
+
+		/**
+		 *  \brief Destroys the layer with the given name and its texture
+		 *
+		 *  \param name the name of the layer
+		 */
+		void DestroyLayer(string name) { layers.erase(name); }
+
+		/**
+		 *  \brief Sets the camera through which Draw, DrawBounds and DrawVisible draw (objects outside its view are skipped)
+		 *
+		 *  \param c the new camera
+		 */
+		void SetCamera(const Render::Camera& c) { camera = c; camera.SetScreenSize(screenW, screenH); }
+
+		/**
+		 *  \return the camera through which this instance draws
+		 */
+		Render::Camera& GetCamera() { return camera; }
+
+		/**
+		 *  \brief Switches drawing to a multi-threaded software rasterizer, which presents its frame as a single texture upload
+		 *
+		 *  Images and texts created after it is enabled have their pixels captured, older textures are read back when first drawn.
+		 *  Drawables which can't be drawn in software are skipped, the dirty rect and render queue modes are bypassed.
+		 *  Must be disabled before the renderer is destroyed.
+		 *
+		 *  \param enable whether to draw in software
+		 *  \param threads the number of rasterizing threads, 0 to use Render::WorkerPool::Shared()
+		 */
+		void EnableSoftwareRaster(bool enable, int threads = 0);
+
+		/**
+		 *  \return the counts of the last frame drawn in software
+		 */
+		Render::SoftwareRasterStats GetSoftwareRasterStats() { return softRaster != nullptr ? softRaster->GetStats() : Render::SoftwareRasterStats(); }
+
+		/**
+		 *  \brief Collects DrawBounds outlines for the frame and draws them on top of it in pres(), with one SDL call per color
+		 *
+		 *  \param enable whether to batch outlines
+		 */
+		void EnableDebugBatch(bool enable) { batchBounds = enable; }
+
+		/**
+		 *  \return the counts of the last flushed batch of outlines
+		 */
+		Render::DebugBatchStats GetDebugBatchStats() { return debugBatch.GetStats(); }
+
+		/**
+		 *  \brief Appends a filter to the post-processing chain which pres() runs over each finished frame
+		 *
+		 *  \param filter the filter to append, which must outlive this instance or be removed
+		 */
+		void AddPostFilter(Render::PostFilter& filter) { postProcess.Add(filter); }
+		void RemovePostFilter(Render::PostFilter& filter) { postProcess.Remove(filter); }
+
+		/**
+		 *  \brief Removes every post-processing filter, must be called before the renderer is destroyed if any were added
+		 */
+		void ClearPostFilters() { postProcess.Clear(); postProcess.Destroy(); }
+
+		/**
+		 *  \return the timings of the last post-processed frame
+		 */
+		Render::PostProcessStats GetPostProcessStats() { return postProcess.GetStats(); }
+
+		/**
+		 *  \brief Starts writing every presented frame to disk on background threads
+		 *
+		 *  \param pathPrefix the start of each file's path, followed by the frame number and extension
+		 *  \param format the format in which frames are written
+		 *  \param writers the number of writer threads
+		 */
+		void StartCapture(string pathPrefix, Render::CaptureFormat format = Render::CAPTURE_PNG, int writers = 1) { frameCapture.Start(pathPrefix, format, writers); }
+
+		/**
+		 *  \brief Stops capturing frames once every queued frame is written
+		 */
+		void StopCapture() { frameCapture.Stop(); }
+
+		/**
+		 *  \return the counts and timings of the current or last capture
+		 */
+		Render::FrameCaptureStats GetCaptureStats() { return frameCapture.GetStats(); }
+
+		/**
+		 *  \brief Draws the Drawables of the given grid which are within the camera's view
+		 *
+		 *  \param grid the SpatialGrid to search
+		 */
+		void DrawVisible(Render::SpatialGrid& grid);
+
+		/**
+		 *  \return the draws submitted and culled during the last presented frame
+		 */
+		Render::CullStats GetCullStats() { return lastCullStats; }
+
+		/**
+		 *  \return the StateTracker which shadows the state of this instance's renderer
+		 */
+		Render::StateTracker& GetStateTracker() { return stateTracker; }
 
 		/**
 		 *  \brief Calls the Update function on the given Updatable if its NeedsUpdate function returns true
@@ -630,7 +3561,7 @@ namespace GFW {
 		 *  \sa PrepUpdate()
 		 *  \sa StopUpdate()
 		 */
-		void UpdateAll() { for (Updatable* updatable : queuedUpdates) Update(*updatable); }
+		void UpdateAll() { Profiling::PhaseScope phase(Profiling::PHASE_UPDATE); for (Updatable* updatable : queuedUpdates) Update(*updatable); }
 
 		/**
 		 *  \brief Stops the given Updatable from being passed to Update by UpdateAll
@@ -686,9 +3617,13 @@ namespace GFW {
 
 	protected:
 		/**
-		 *  \brief The SDL_Window which is controlled by this Inst
+		 *  \brief The SDL_Window which is controlled by this Inst (nullptr in headless mode)
 		 */
-		SDL_Window* window;
+		SDL_Window* window = nullptr;
+		/**
+		 *  \brief The surface which is rendered into in headless mode, or nullptr
+		 */
+		SDL_Surface* frameSurface = nullptr;
 		/**
 		 *  \brief A SDL_Renderer which can be used to draw onto the window
 		 */
@@ -741,6 +3676,75 @@ namespace GFW {
 		 *  \brief The Updatables which will be passed to Update when UpdateAll is called
 		 */
 		vector<Updatable*> queuedUpdates;
+		/**
+		 *  \brief Skips redundant state changes on renderer
+		 */
+		Render::StateTracker stateTracker;
+		/**
+		 *  \brief Records draws and finds damaged areas when dirtyRects is set
+		 */
+		Render::DamageTracker damageTracker;
+		/**
+		 *  \brief Whether only damaged areas are redrawn
+		 * 
+		 *  \sa EnableDirtyRects()
+		 */
+		bool dirtyRects = false;
+		/**
+		 *  \brief The persistent texture into which frames are drawn in dirty rect mode
+		 */
+		SDL_Texture* frameTarget = nullptr;
+		/**
+		 *  \brief The width and height of the window
+		 */
+		int screenW = 0, screenH = 0;
+		/**
+		 *  \brief The filters run over each finished frame
+		 */
+		Render::PostProcess postProcess;
+		/**
+		 *  \brief Collects the outlines passed to DrawBounds while batchBounds is set
+		 */
+		Render::DebugBatch debugBatch;
+		bool batchBounds = false;
+		/**
+		 *  \brief Writes presented frames to disk while capturing
+		 */
+		Render::FrameCapture frameCapture;
+		/**
+		 *  \brief The software rasterizer which is drawn into instead of the renderer, or nullptr
+		 */
+		Render::SoftwareRenderer* softRaster = nullptr;
+		/**
+		 *  \brief The camera through which this instance draws
+		 */
+		Render::Camera camera;
+		/**
+		 *  \brief The culling counts of the current and the last presented frame
+		 */
+		Render::CullStats cullStats, lastCullStats;
+		/**
+		 *  \brief The cached static layers of this instance by name
+		 * 
+		 *  \sa Layer()
+		 */
+		map<string, Render::StaticLayer> layers;
+		/**
+		 *  \brief The draws queued since the last pres() when queueDraws is set
+		 */
+		Render::RenderQueue renderQueue;
+		/**
+		 *  \brief Whether Draw and DrawBounds queue their draws
+		 * 
+		 *  \sa EnableRenderQueue()
+		 */
+		bool queueDraws = false;
+		/**
+		 *  \brief The layer into which draws are queued
+		 * 
+		 *  \sa SetDrawLayer()
+		 */
+		int drawLayer = 0;
 		/**
 		 *  \brief A common instance of FontManager for all instances
 		 */
@@ -6,6 +6,9 @@
 #include <string>
 #include <functional>
 #include <map>
+#include <list>
+#include <deque>
+#include <unordered_map>
 #include <conio.h> 
 #include <sys/types.h> 
 #include <sys/stat.h> 
@@ -14,8 +17,20 @@
 #include <stdarg.h>
 #include <fstream>
 #include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <numeric>
 #include <cmath>
+#include <climits>
+#include <cfloat>
+#include <typeinfo>
+//SSE2 is part of every x64 CPU and of x86 builds targeting it, the portable code is used elsewhere (or with GFW_NO_SSE2)
+#if !defined(GFW_NO_SSE2) && (defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define GFW_SSE2
+#include <emmintrin.h>
+#endif
 #include <windows.h>
 
 
@@ -49,6 +49,9 @@ void BoundsEditor::BoundsEditor::ep()
 
 void BoundsEditor::BoundsEditor::cleanup()
 {
+	stateTracker.Detach();
+	Image::Image::textureCache.Clear();
+	Circle::Circle::spriteCache.Clear();
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
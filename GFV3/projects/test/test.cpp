@@ -125,6 +125,9 @@ void test_proj::test_proj::ep()
 
 void test_proj::test_proj::cleanup()
 {
+	stateTracker.Detach();
+	Image::Image::textureCache.Clear();
+	Circle::Circle::spriteCache.Clear();
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
 	SDL_Quit();